@@ -0,0 +1,142 @@
+/*
+* 2D copy (blit) kernels.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "fastcopy/blit.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/pie.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+
+namespace fastcopy {
+
+IRAM_ATTR void copy_2d_memcpy(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride)
+{
+    uint8_t* dest_row = (uint8_t*)dest;
+    const uint8_t* src_row = (const uint8_t*)source;
+    for(size_t row = 0; row < height; row++) {
+        memcpy(dest_row, src_row, width);
+        dest_row += destStride;
+        src_row += sourceStride;
+    }
+}
+
+IRAM_ATTR void copy_2d_pie(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride)
+{
+    if((((uintptr_t)dest | (uintptr_t)source | width | destStride | sourceStride) & 0xf) != 0) {
+        uint8_t* dest_row = (uint8_t*)dest;
+        const uint8_t* src_row = (const uint8_t*)source;
+        for(size_t row = 0; row < height; row++) {
+            copy_pie_unaligned(dest_row, src_row, width);
+            dest_row += destStride;
+            src_row += sourceStride;
+        }
+        return;
+    }
+
+    const uint32_t cnt = width / 32;
+    const bool odd = (width & 16) != 0;
+    const size_t destSkip = destStride - width;
+    const size_t srcSkip = sourceStride - width;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    for(size_t row = 0; row < height; row++) {
+        // Same 32 byte loop as copy_pie_32()
+        rpt(cnt, [&src_p,&dest_p]() {
+            vld_128_ip<0>(src_p);
+            vld_128_ip<1>(src_p);
+            vst_128_ip<0>(dest_p);
+            vst_128_ip<1>(dest_p);
+        });
+        if(odd) {
+            vld_128_ip<0>(src_p);
+            vst_128_ip<0>(dest_p);
+        }
+        src_p = (const uint8_t*)src_p + srcSkip;
+        dest_p = (uint8_t*)dest_p + destSkip;
+    }
+}
+
+bool dma_capable_2d(const void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride)
+{
+    if(height == 0) {
+        return false;
+    }
+    const uint32_t ls = internal::getCacheLineSize();
+    if((isExtMem(dest) || isExtMem(source)) && ((destStride | sourceStride) & (ls-1)) != 0) {
+        return false;
+    }
+    // With aligned strides, the first and the last row stand for all the others.
+    const size_t last = height - 1;
+    return dma_capable(dest, source, width) &&
+           dma_capable((const uint8_t*)dest + last * destStride, (const uint8_t*)source + last * sourceStride, width);
+}
+
+IRAM_ATTR esp_err_t copy_2d_dma(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride)
+{
+    if(width == destStride && width == sourceStride) {
+        return copy_dma(dest, source, width * height);
+    }
+
+    DmaService* service;
+    const esp_err_t serviceStarted = dmaService(&service);
+    if(serviceStarted != ESP_OK) {
+        return serviceStarted;
+    }
+    if(height == 0) {
+        return ESP_OK;
+    }
+
+    // Per row rather than over the whole span, so lines between the rows are left alone.
+    const bool extDest = isExtMem(dest);
+    const bool extSrc = isExtMem(source);
+    uint8_t* dest_row = (uint8_t*)dest;
+    const uint8_t* src_row = (const uint8_t*)source;
+    for(size_t row = 0; row < height; row++) {
+        if(extSrc) {
+            esp_cache_msync((void*)src_row, width, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+        if(extDest) {
+            esp_cache_msync(dest_row, width, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+        dest_row += destStride;
+        src_row += sourceStride;
+    }
+
+    // The requests complete in order, so only the last row needs to be waited for.
+    esp_err_t r = ESP_OK;
+    dest_row = (uint8_t*)dest;
+    src_row = (const uint8_t*)source;
+    for(size_t row = 0; row + 1 < height && r == ESP_OK; row++) {
+        r = service->submit(dest_row, src_row, width, nullptr, nullptr);
+        dest_row += destStride;
+        src_row += sourceStride;
+    }
+    if(r == ESP_OK) {
+        r = service->copy(dest_row, src_row, width);
+    }
+    if(r != ESP_OK) {
+        service->waitIdle();
+    }
+
+    if(extDest && r == ESP_OK) {
+        dest_row = (uint8_t*)dest;
+        for(size_t row = 0; row < height; row++) {
+            esp_cache_msync(dest_row, width, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+            dest_row += destStride;
+        }
+    }
+
+    return r;
+}
+
+} // namespace fastcopy
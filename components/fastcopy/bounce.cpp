@@ -0,0 +1,204 @@
+/*
+* BounceCopy: PSRAM->PSRAM through two internal RAM tiles.
+*
+* The DMA leg runs on the shared DmaService with a task notification per
+* transfer, as in StreamPipeline, and never has more than one transfer in flight,
+* so each notification belongs to exactly one wait. Only whole cache lines go
+* through the DMA; the few bytes left over at the very end are copied by the CPU.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/bounce.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+#include "fastcopy/pool.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+/// @brief Writes a destination range back from the cache, lines shared with neighbouring data included
+static inline void writeBackUnaligned(void* addr, size_t size) {
+    if(size != 0) {
+        esp_cache_msync(addr, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+    }
+}
+
+esp_err_t BounceCopy::start(size_t tileSize, BounceDma dma, BufferPool* pool)
+{
+    if(started()) {
+        return ESP_OK;
+    }
+
+    const size_t ls = internal::getCacheLineSize();
+    size = (tileSize + (ls-1)) & ~(ls-1);
+    leg = dma;
+    tilePool = pool;
+    for(void*& tile : tiles) {
+        tile = pool ? pool->acquire(size) : heap_caps_aligned_alloc(ls, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        if(!tile) {
+            ESP_LOGE(TAG, "Failed to allocate the bounce tiles");
+            stop();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void BounceCopy::stop()
+{
+    for(void*& tile : tiles) {
+        if(tilePool && tile) {
+            tilePool->release(tile);
+        } else {
+            free(tile);
+        }
+        tile = nullptr;
+    }
+    tilePool = nullptr;
+    size = 0;
+}
+
+IRAM_ATTR esp_err_t BounceCopy::copy(void* dest, const void* source, size_t length)
+{
+    if(!started()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    DmaService* service = nullptr;
+    if(leg != BounceDma::None) {
+        const esp_err_t serviceStarted = dmaService(&service);
+        if(serviceStarted != ESP_OK) {
+            return serviceStarted;
+        }
+    }
+    const size_t ls = internal::getCacheLineSize();
+    if((leg == BounceDma::Read && ((uintptr_t)source & (ls-1)) != 0) ||
+       (leg == BounceDma::Write && ((uintptr_t)dest & (ls-1)) != 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    counters = {};
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    uint8_t* dst = (uint8_t*)dest;
+    const uint8_t* src = (const uint8_t*)source;
+    const uint32_t count = (length + size - 1) / size;
+    // The DMA moves whole lines only: everything up to here, the CPU does the rest.
+    const size_t dmaLength = length & ~(ls-1);
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    bool inFlight = false;
+    auto wait = [&]() {
+        if(inFlight) {
+            const uint32_t twait = esp_cpu_get_cycle_count();
+            DmaService::waitNotified();
+            counters.waitCycles += esp_cpu_get_cycle_count() - twait;
+            inFlight = false;
+        }
+    };
+    auto dmaLen = [&](size_t offset, size_t len) -> size_t {
+        return offset >= dmaLength ? 0 : (dmaLength - offset < len ? dmaLength - offset : len);
+    };
+
+    esp_err_t r = ESP_OK;
+
+    if(leg == BounceDma::None) {
+        for(uint32_t i = 0; i < count; i++) {
+            const size_t offset = (size_t)i * size;
+            const size_t len = (length - offset) < size ? (length - offset) : size;
+            memcpy(tiles[0], src + offset, len);
+            memcpy(dst + offset, tiles[0], len);
+            writeBackUnaligned(dst + offset, len);
+            counters.tiles++;
+        }
+        counters.cpuCycles = esp_cpu_get_cycle_count() - tstart;
+    }
+    else if(leg == BounceDma::Read) {
+        // Whole lines only; the part of the last line past the end is written back too, which is harmless.
+        esp_cache_msync((void*)source, (length + (ls-1)) & ~(ls-1), ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+
+        // Fetches tile i into tiles[i & 1]
+        auto fetch = [&](uint32_t i) -> esp_err_t {
+            const size_t offset = (size_t)i * size;
+            const size_t len = dmaLen(offset, size);
+            if(len == 0) {
+                return ESP_OK;
+            }
+            const esp_err_t e = service->submit(tiles[i & 1], src + offset, len, task);
+            inFlight = (e == ESP_OK);
+            return e;
+        };
+
+        r = count ? fetch(0) : ESP_OK;
+        for(uint32_t i = 0; i < count && r == ESP_OK; i++) {
+            const size_t offset = (size_t)i * size;
+            const size_t len = (length - offset) < size ? (length - offset) : size;
+            const size_t fetched = dmaLen(offset, len);
+            uint8_t* tile = (uint8_t*)tiles[i & 1];
+
+            wait();
+            if(i + 1 < count) {
+                r = fetch(i + 1);
+            }
+
+            const uint32_t tcpu = esp_cpu_get_cycle_count();
+            memcpy(tile + fetched, src + offset + fetched, len - fetched);
+            memcpy(dst + offset, tile, len);
+            writeBackUnaligned(dst + offset, len);
+            counters.cpuCycles += esp_cpu_get_cycle_count() - tcpu;
+            counters.tiles++;
+        }
+        wait();
+    }
+    else {
+        // No dirty destination lines may be written back over the DMA'd data later.
+        if(dmaLength != 0) {
+            esp_cache_msync(dest, dmaLength, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+
+        for(uint32_t i = 0; i < count && r == ESP_OK; i++) {
+            const size_t offset = (size_t)i * size;
+            const size_t len = (length - offset) < size ? (length - offset) : size;
+            const size_t written = dmaLen(offset, len);
+            uint8_t* tile = (uint8_t*)tiles[i & 1];
+
+            // Read this tile in while the DMA writes out the previous one.
+            const uint32_t tcpu = esp_cpu_get_cycle_count();
+            memcpy(tile, src + offset, len);
+            counters.cpuCycles += esp_cpu_get_cycle_count() - tcpu;
+
+            wait();
+            if(written != 0) {
+                r = service->submit(dst + offset, tile, written, task);
+                inFlight = (r == ESP_OK);
+            }
+            if(written != len) {
+                memcpy(dst + offset + written, tile + written, len - written);
+                writeBackUnaligned(dst + offset + written, len - written);
+            }
+            counters.tiles++;
+        }
+        wait();
+
+        if(dmaLength != 0) {
+            esp_cache_msync(dest, dmaLength, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+    }
+
+    counters.totalCycles = esp_cpu_get_cycle_count() - tstart;
+    return r;
+}
+
+} // namespace fastcopy
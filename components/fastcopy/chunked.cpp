@@ -0,0 +1,140 @@
+/*
+* ChunkedDma: large copies as a stream of fixed size async_memcpy requests.
+*
+* Chunks complete in the order they were submitted, so a counting semaphore
+* given from the DMA ISR is enough to know which chunk is done: the n-th take
+* belongs to the n-th chunk still in flight. That is also when its destination
+* lines are invalidated, while later chunks are still being copied.
+*
+*/
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+
+#include "fastcopy/chunked.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/kernels.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+esp_err_t ChunkedDma::start(const ChunkedDmaConfig& config)
+{
+    if(started()) {
+        return ESP_OK;
+    }
+
+    const uint32_t ls = internal::getCacheLineSize();
+    if(config.depth == 0 || config.chunkSize < ls) {
+        ESP_LOGE(TAG, "Invalid chunked DMA config: %u byte chunks, depth %" PRIu32, (unsigned)config.chunkSize, config.depth);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    done = xSemaphoreCreateCounting(config.depth, 0);
+    if(!done) {
+        ESP_LOGE(TAG, "Failed to allocate the chunked DMA");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_err_t r = service.start({ config.depth, ls });
+    if(r != ESP_OK) {
+        stop();
+        return r;
+    }
+
+    chunk = config.chunkSize & ~(size_t)(ls-1);
+    depth = config.depth;
+    counters = {};
+    return ESP_OK;
+}
+
+void ChunkedDma::stop()
+{
+    service.stop();
+    if(done) {
+        vSemaphoreDelete(done);
+        done = nullptr;
+    }
+    chunk = 0;
+    depth = 0;
+}
+
+IRAM_ATTR esp_err_t ChunkedDma::copy(void* dest, const void* source, size_t size)
+{
+    if(!started()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if(!dma_capable(dest, source, size)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    counters = {};
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    uint8_t* const dst = (uint8_t*)dest;
+    const uint8_t* const src = (const uint8_t*)source;
+    const bool extDest = isExtMem(dest);
+    const bool extSrc = isExtMem(source);
+
+    size_t submitted = 0; // bytes handed to the DMA
+    size_t completed = 0; // bytes known to be done
+    uint32_t inFlight = 0;
+    esp_err_t r = ESP_OK;
+
+    // Waits for the oldest chunk in flight and invalidates its destination lines.
+    auto retire = [&]() {
+        const uint32_t twait = esp_cpu_get_cycle_count();
+        xSemaphoreTake(done, portMAX_DELAY);
+        const uint32_t tdone = esp_cpu_get_cycle_count();
+        counters.waitCycles += tdone - twait;
+
+        const size_t len = (submitted - completed) < chunk ? (submitted - completed) : chunk;
+        if(extDest) {
+            esp_cache_msync(dst + completed, len, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+        completed += len;
+        inFlight--;
+        counters.cpuCycles += esp_cpu_get_cycle_count() - tdone;
+    };
+
+    while(submitted < size && r == ESP_OK) {
+        if(inFlight == depth) {
+            retire();
+        }
+
+        const uint32_t tcpu = esp_cpu_get_cycle_count();
+        const size_t len = (size - submitted) < chunk ? (size - submitted) : chunk;
+
+        // The DMA bypasses the cache: write back this chunk of the source, and make sure
+        // no dirty destination lines are written back over the DMA'd data later.
+        if(extSrc) {
+            esp_cache_msync((void*)(src + submitted), len, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+        if(extDest) {
+            esp_cache_msync(dst + submitted, len, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+        }
+
+        r = service.submit(dst + submitted, src + submitted, len, &DmaService::giveSemaphoreFromIsr, (void*)done);
+        if(r == ESP_OK) {
+            submitted += len;
+            inFlight++;
+            counters.chunks++;
+        }
+        counters.cpuCycles += esp_cpu_get_cycle_count() - tcpu;
+    }
+
+    // Drain: the callbacks reference the semaphore, so every submitted chunk must be waited for.
+    while(inFlight != 0) {
+        retire();
+    }
+
+    counters.totalCycles = esp_cpu_get_cycle_count() - tstart;
+    return r;
+}
+
+} // namespace fastcopy
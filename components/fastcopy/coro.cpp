@@ -0,0 +1,98 @@
+/*
+* The FreeRTOS side of the coroutine copies: the executor and the DMA engine.
+*
+* The queue carries coroutine frame addresses. Each task waits for at most one
+* copy at a time, so a queue as long as the number of tasks can never overflow
+* and the ISR never has to drop a resume.
+*
+*/
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+#include "esp_cache.h"
+
+#include "fastcopy/coro.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+esp_err_t FreeRtosExecutor::start(uint32_t tasks)
+{
+    if(queue) {
+        return ESP_OK;
+    }
+    queue = xQueueCreate(tasks, sizeof(void*));
+    if(!queue) {
+        ESP_LOGE(TAG, "Failed to allocate the executor queue");
+        return ESP_ERR_NO_MEM;
+    }
+    maxTasks = tasks;
+    return ESP_OK;
+}
+
+void FreeRtosExecutor::stop()
+{
+    if(queue) {
+        if(pending() != 0) {
+            ESP_LOGE(TAG, "Executor stopped with %" PRIu32 " tasks left", pending());
+        }
+        vQueueDelete(queue);
+        queue = nullptr;
+    }
+}
+
+IRAM_ATTR bool FreeRtosExecutor::post(std::coroutine_handle<> h)
+{
+    void* const frame = h.address();
+    if(xPortInIsrContext()) {
+        BaseType_t r = pdFALSE;
+        xQueueSendFromISR(queue, &frame, &r);
+        return (r!=pdFALSE);
+    }
+    xQueueSend(queue, &frame, portMAX_DELAY);
+    return false;
+}
+
+void FreeRtosExecutor::run()
+{
+    while(pending() != 0) {
+        void* frame;
+        if(xQueueReceive(queue, &frame, portMAX_DELAY) == pdTRUE) {
+            std::coroutine_handle<>::from_address(frame).resume();
+        }
+    }
+}
+
+
+IRAM_ATTR esp_err_t CachedDma::submit(void* dest, const void* source, size_t size, bool (*cb)(void*), void* arg)
+{
+    DmaService* service;
+    const esp_err_t serviceStarted = dmaService(&service);
+    if(serviceStarted != ESP_OK) {
+        return serviceStarted;
+    }
+
+    // As copy_dma(): write back the source, and keep dirty destination lines from being written back later.
+    if(isExtMem(source)) {
+        esp_cache_msync((void*)source, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+    if(isExtMem(dest)) {
+        esp_cache_msync(dest, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+    return service->submit(dest, source, size, cb, arg);
+}
+
+IRAM_ATTR void CachedDma::finish(void* dest, size_t size)
+{
+    if(isExtMem(dest)) {
+        esp_cache_msync(dest, size, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+}
+
+} // namespace fastcopy
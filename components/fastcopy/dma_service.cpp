@@ -0,0 +1,235 @@
+/*
+* A long-lived async_memcpy (GDMA) copy service.
+*
+* Requests go straight into the driver's backlog. A counting semaphore holds one
+* token per backlog entry, so submit() only blocks when the queue is full, and each
+* in-flight request has a slot which carries its completion target into the ISR.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "fastcopy/dma_service.hpp"
+#include "fastcopy/cache.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+esp_err_t DmaService::start(const DmaServiceConfig& config)
+{
+    if(handle) {
+        return ESP_OK;
+    }
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    requests = (Request*)heap_caps_calloc(config.depth, sizeof(Request), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    slots = xSemaphoreCreateCounting(config.depth, config.depth);
+    if(!requests || !slots) {
+        ESP_LOGE(TAG, "Failed to allocate the DMA service");
+        stop();
+        return ESP_ERR_NO_MEM;
+    }
+
+    const async_memcpy_config_t cfg = {
+        .backlog = config.depth,
+        .sram_trans_align = 0,
+        .psram_trans_align = config.psramAlign,
+        .flags = 0
+    };
+    async_memcpy_t installed = nullptr;
+    const esp_err_t r = esp_async_memcpy_install(&cfg, &installed);
+    if (r != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install DMA driver: %i",r);
+        stop();
+        return r;
+    }
+
+    depth = config.depth;
+    inFlight = 0;
+    counters = {};
+    counters.setupCycles = esp_cpu_get_cycle_count() - tstart;
+    // Last, as started() is what dmaService() checks without its lock.
+    handle = installed;
+    return ESP_OK;
+}
+
+void DmaService::stop()
+{
+    if(handle) {
+        waitIdle();
+        esp_async_memcpy_uninstall(handle);
+        handle = nullptr;
+    }
+    if(slots) {
+        vSemaphoreDelete(slots);
+        slots = nullptr;
+    }
+    free(requests);
+    requests = nullptr;
+    depth = 0;
+}
+
+IRAM_ATTR bool DmaService::onDone(async_memcpy_t, async_memcpy_event_t*, void* args)
+{
+    const uint32_t now = esp_cpu_get_cycle_count();
+    Request* const req = (Request*)args;
+    DmaService* const service = req->service;
+
+    // Take what we need before the slot is handed back.
+    const DmaDoneCallback cb = req->cb;
+    void* const arg = req->arg;
+    const TaskHandle_t task = req->task;
+
+    portENTER_CRITICAL_ISR(&service->lock);
+    service->counters.completed++;
+    service->counters.bytes += req->size;
+    service->counters.latencyCycles += now - req->start;
+    if(--service->inFlight == 0) {
+        service->counters.busyCycles += now - service->busyStart;
+    }
+    req->busy = false;
+    portEXIT_CRITICAL_ISR(&service->lock);
+
+    BaseType_t r = pdFALSE;
+    xSemaphoreGiveFromISR(service->slots, &r);
+    bool woken = (r != pdFALSE);
+
+    if(task) {
+        r = pdFALSE;
+        xTaskNotifyIndexedFromISR(task, NOTIFY_INDEX, now, eSetValueWithOverwrite, &r);
+        woken |= (r != pdFALSE);
+    }
+    if(cb) {
+        woken |= cb(arg);
+    }
+    return woken;
+}
+
+IRAM_ATTR esp_err_t DmaService::submitRequest(void* dest, const void* source, size_t size, DmaDoneCallback cb, void* arg, TaskHandle_t task)
+{
+    if(!handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    // Wait for room in the backlog, then claim a slot for the request.
+    xSemaphoreTake(slots, portMAX_DELAY);
+
+    Request* req = nullptr;
+    portENTER_CRITICAL(&lock);
+    for(uint32_t i = 0; i < depth; i++) {
+        if(!requests[i].busy) {
+            req = &requests[i];
+            break;
+        }
+    }
+    // The semaphore guarantees a free slot.
+    *req = { this, cb, arg, task, size, esp_cpu_get_cycle_count(), true };
+    if(inFlight++ == 0) {
+        busyStart = req->start;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    const esp_err_t r = esp_async_memcpy(handle, dest, (void*)source, size, &onDone, req);
+
+    const uint32_t cycles = esp_cpu_get_cycle_count() - tstart;
+    portENTER_CRITICAL(&lock);
+    if(r == ESP_OK) {
+        counters.submitted++;
+    } else {
+        req->busy = false;
+        inFlight--;
+    }
+    counters.submitCycles += cycles;
+    if(cycles > counters.maxSubmitCycles) {
+        counters.maxSubmitCycles = cycles;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    if(r != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start async_memcpy: %i",r);
+        xSemaphoreGive(slots);
+    }
+    return r;
+}
+
+esp_err_t DmaService::submit(void* dest, const void* source, size_t size, DmaDoneCallback cb, void* arg)
+{
+    return submitRequest(dest, source, size, cb, arg, nullptr);
+}
+
+esp_err_t DmaService::submit(void* dest, const void* source, size_t size, TaskHandle_t task)
+{
+    return submitRequest(dest, source, size, nullptr, nullptr, task);
+}
+
+uint32_t DmaService::waitNotified()
+{
+    uint32_t tdone = 0;
+    xTaskNotifyWaitIndexed(NOTIFY_INDEX, 0, UINT32_MAX, &tdone, portMAX_DELAY);
+    return tdone;
+}
+
+IRAM_ATTR bool DmaService::giveSemaphoreFromIsr(void* arg)
+{
+    BaseType_t r = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &r);
+    return (r!=pdFALSE);
+}
+
+void DmaService::waitIdle()
+{
+    // Holding every token means nothing is in flight.
+    for(uint32_t i = 0; i < depth; i++) {
+        xSemaphoreTake(slots, portMAX_DELAY);
+    }
+    for(uint32_t i = 0; i < depth; i++) {
+        xSemaphoreGive(slots);
+    }
+}
+
+DmaServiceStats DmaService::stats() const
+{
+    portENTER_CRITICAL(&lock);
+    const DmaServiceStats s = counters;
+    portEXIT_CRITICAL(&lock);
+    return s;
+}
+
+void DmaService::resetStats()
+{
+    portENTER_CRITICAL(&lock);
+    const uint32_t setupCycles = counters.setupCycles;
+    counters = {};
+    counters.setupCycles = setupCycles;
+    portEXIT_CRITICAL(&lock);
+}
+
+esp_err_t dmaService(DmaService** service)
+{
+    static DmaService shared;
+    static StaticSemaphore_t lockBuffer;
+    static const SemaphoreHandle_t lock = xSemaphoreCreateMutexStatic(&lockBuffer);
+
+    // Once running the service is never stopped, so only the calls before that need the lock.
+    esp_err_t r = ESP_OK;
+    if(!shared.started()) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        r = shared.start({ CONFIG_FASTCOPY_DMA_BACKLOG, internal::getCacheLineSize() });
+        xSemaphoreGive(lock);
+    }
+    *service = r == ESP_OK ? &shared : nullptr;
+    return r;
+}
+
+} // namespace fastcopy
@@ -0,0 +1,134 @@
+/*
+* fast_memcpy() - picks a copy kernel based on memory region, alignment and size.
+*
+* The choices themselves are made in fastcopy/dispatch.hpp, which is portable
+* so they can be tested on the host.
+*
+* The choices follow the memorycopy benchmark results (100kb, 240 MHz):
+*
+*   IRAM->IRAM    PIE 128-bit 32 byte loop   ~1830 MB/s (memcpy ~366 MB/s)
+*                 PIE with EE.SRC.Q realignment when misaligned or odd sized
+*   IRAM->PSRAM   all CPU methods are equal  ~32.5 MB/s, use memcpy
+*   PSRAM->IRAM   all CPU methods are equal  ~58 MB/s, use memcpy
+*   PSRAM->PSRAM  async_memcpy               ~26.4 MB/s (CPU ~21 MB/s)
+*                 split with the CPU once hybrid_calibrate() has found a better share
+*
+* Small copies always go to memcpy, which has the lowest setup cost.
+*
+* The DMA path blocks until the copy is done, so it is only taken by a caller
+* that may block: not from an ISR, a critical section or with the scheduler
+* suspended. Those get the CPU instead.
+*
+* The PIE kernels use the Q registers, whose state FreeRTOS only saves lazily,
+* on a coprocessor exception in task context. From an ISR or inside a critical
+* section that would fault or clobber the interrupted task's registers, so
+* there every entry point uses the libc function instead.
+*
+* fast_memmove() hands copies that don't overlap to fast_memcpy() and moves the
+* rest with the PIE kernels, in IRAM and PSRAM alike.
+*
+* fast_memset() follows the same split: the PIE fill within internal RAM,
+* memset for PSRAM and for small fills.
+*
+*/
+
+#include <string.h>
+#include <stdint.h>
+
+#include "fastcopy.h"
+
+#if FASTCOPY_HAS_PIE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/hybrid.hpp"
+#include "fastcopy/dispatch.hpp"
+#endif
+
+#if FASTCOPY_HAS_PIE
+
+/// @brief Whether the caller may use the PIE (Q register) kernels
+static inline IRAM_ATTR bool canUsePie()
+{
+    // xPortCanYield() is false inside a critical section.
+    return !xPortInIsrContext() && xPortCanYield();
+}
+
+
+extern "C" IRAM_ATTR void* fast_memcpy(void* dest, const void* src, size_t size)
+{
+    using namespace fastcopy;
+
+    CopyContext ctx = { isExtMem(dest), isExtMem(src), false, canUsePie(), false };
+    if(ctx.extDest && ctx.extSrc && size >= CONFIG_FASTCOPY_DMA_MIN_SIZE) {
+        ctx.dmaCapable = dma_capable(dest, src, size);
+        ctx.canBlock = ctx.canUsePie && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+    }
+
+    switch(copy_path((uintptr_t)dest, (uintptr_t)src, size, ctx)) {
+        case CopyPath::Pie32:
+            copy_pie_32(dest, src, size);
+            return dest;
+        case CopyPath::PieUnaligned:
+            copy_pie_unaligned(dest, src, size);
+            return dest;
+        case CopyPath::Hybrid:
+            // The CPU copies part of the buffer alongside the DMA (see hybrid_calibrate()).
+            if(copy_hybrid(dest, src, size) == ESP_OK) {
+                return dest;
+            }
+            break;
+        case CopyPath::Libc:
+            break;
+    }
+    return memcpy(dest, src, size);
+}
+
+extern "C" IRAM_ATTR void* fast_memmove(void* dest, const void* src, size_t size)
+{
+    using namespace fastcopy;
+
+    switch(move_path((uintptr_t)dest, (uintptr_t)src, size, canUsePie())) {
+        case MovePath::Copy:
+            return fast_memcpy(dest, src, size);
+        case MovePath::Pie:
+            move_pie(dest, src, size);
+            return dest;
+        case MovePath::Libc:
+            break;
+    }
+    return memmove(dest, src, size);
+}
+
+extern "C" IRAM_ATTR void* fast_memset(void* dest, int value, size_t size)
+{
+    using namespace fastcopy;
+
+    if(fill_uses_pie(size, isExtMem(dest), canUsePie())) {
+        fill_pie(dest, (uint8_t)value, size);
+        return dest;
+    }
+    return memset(dest, value, size);
+}
+
+#else
+
+// Portable fallback, e.g. for the linux target.
+extern "C" void* fast_memcpy(void* dest, const void* src, size_t size)
+{
+    return memcpy(dest, src, size);
+}
+
+extern "C" void* fast_memmove(void* dest, const void* src, size_t size)
+{
+    return memmove(dest, src, size);
+}
+
+extern "C" void* fast_memset(void* dest, int value, size_t size)
+{
+    return memset(dest, value, size);
+}
+
+#endif
@@ -0,0 +1,128 @@
+/*
+* Hybrid copy: one transfer split between the GDMA and the CPU.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_cpu.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "fastcopy/hybrid.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+
+namespace fastcopy {
+
+/// @brief Shares per region pair, indexed by region_index(). Until calibrated only PSRAM->PSRAM
+/// uses the DMA, which is what fast_memcpy did before the hybrid copy existed.
+static uint32_t shares[4] = {
+    0,                  // IRAM->IRAM
+    0,                  // IRAM->PSRAM
+    0,                  // PSRAM->IRAM
+    HYBRID_SHARE_MAX,   // PSRAM->PSRAM
+};
+
+static inline uint32_t region_index(const void* dest, const void* source) {
+    return (isExtMem(source) ? 2 : 0) | (isExtMem(dest) ? 1 : 0);
+}
+
+uint32_t hybrid_share(const void* dest, const void* source) {
+    return shares[region_index(dest, source)];
+}
+
+void hybrid_set_share(const void* dest, const void* source, uint32_t dmaShare) {
+    shares[region_index(dest, source)] = dmaShare < HYBRID_SHARE_MAX ? dmaShare : HYBRID_SHARE_MAX;
+}
+
+IRAM_ATTR esp_err_t copy_hybrid(void* dest, const void* source, size_t size, uint32_t dmaShare)
+{
+    const uint32_t ls = internal::getCacheLineSize();
+    size_t dmaBytes = ((uint64_t)size * dmaShare / HYBRID_SHARE_MAX) & ~(size_t)(ls-1);
+
+    // Without the DMA service the CPU does it all.
+    DmaService* service = nullptr;
+    if(dmaBytes != 0 && (dmaService(&service) != ESP_OK || !dma_capable(dest, source, dmaBytes))) {
+        dmaBytes = 0;
+    }
+    if(dmaBytes == 0) {
+        copy_cpu(dest, source, size);
+        return ESP_OK;
+    }
+    if(dmaBytes == size) {
+        return copy_dma(dest, source, size);
+    }
+
+    // Same cache rules as copy_dma(), for the DMA's part only. The split is on a
+    // cache line boundary so the CPU's part never shares a line with it.
+    const bool extDest = isExtMem(dest);
+    if(isExtMem(source)) {
+        esp_cache_msync((void*)source, dmaBytes, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+    if(extDest) {
+        esp_cache_msync(dest, dmaBytes, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+
+    // The CPU copies its part while the DMA runs. If the DMA failed to start it does the lot.
+    const esp_err_t r = service->copy(dest, source, dmaBytes, [=]() {
+        copy_cpu((uint8_t*)dest + dmaBytes, (const uint8_t*)source + dmaBytes, size - dmaBytes);
+    });
+    if(r != ESP_OK) {
+        copy_cpu(dest, source, size);
+    }
+
+    if(extDest && r == ESP_OK) {
+        esp_cache_msync(dest, dmaBytes, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+
+    return ESP_OK;
+}
+
+IRAM_ATTR esp_err_t copy_hybrid(void* dest, const void* source, size_t size)
+{
+    return copy_hybrid(dest, source, size, hybrid_share(dest, source));
+}
+
+uint32_t hybrid_calibrate(void* dest, const void* source, size_t size, uint32_t* cycles)
+{
+    const bool extDest = isExtMem(dest);
+    uint32_t best = 0;
+    uint32_t bestCycles = UINT32_MAX;
+
+    for(uint32_t i = 0; i < HYBRID_CALIBRATION_POINTS; i++) {
+        const uint32_t share = i * HYBRID_SHARE_MAX / (HYBRID_CALIBRATION_POINTS - 1);
+
+        // Start every run with the source in memory and nothing of the destination cached.
+        if(isExtMem(source)) {
+            uncacheForRead((void*)source, size);
+        }
+        if(extDest) {
+            uncacheForWrite(dest, size);
+        }
+
+        const uint32_t tstart = esp_cpu_get_cycle_count();
+        copy_hybrid(dest, source, size, share);
+        if(extDest) {
+            compiler_mem_barrier(dest, size);
+            flushCache(dest, size);
+        }
+        const uint32_t t = esp_cpu_get_cycle_count() - tstart;
+
+        if(cycles) {
+            cycles[i] = t;
+        }
+        if(t < bestCycles) {
+            bestCycles = t;
+            best = share;
+        }
+    }
+
+    hybrid_set_share(dest, source, best);
+    return best;
+}
+
+} // namespace fastcopy
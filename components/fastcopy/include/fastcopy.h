@@ -0,0 +1,70 @@
+/*
+* fastcopy - region-aware memory copy for the ESP32-S3
+*
+* A drop-in replacement for memcpy which picks the fastest kernel measured by the
+* memorycopy benchmark for the given source/destination memory regions, alignment
+* and size.
+*
+* On targets without the ESP32-S3 PIE extensions (e.g. the ESP-IDF linux target)
+* every entry point falls back to portable C so code using it can be built and
+* tested on the host.
+*
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+/// @brief Non-zero when the ESP32-S3 PIE 128-bit SIMD instructions are available
+#if CONFIG_IDF_TARGET_ESP32S3
+#define FASTCOPY_HAS_PIE 1
+#else
+#define FASTCOPY_HAS_PIE 0
+#endif
+
+/// @brief Non-zero when the async_memcpy (GDMA) driver is available
+#if CONFIG_SOC_ASYNC_MEMCPY_SUPPORTED
+#define FASTCOPY_HAS_DMA 1
+#else
+#define FASTCOPY_HAS_DMA 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// @brief Copies \p size bytes from \p src to \p dest using the fastest kernel for the memory involved.
+/// The buffers must not overlap. Cache coherency is handled internally where a DMA path is used.
+/// Large PSRAM->PSRAM copies block on the DMA, and internal RAM copies use the PIE Q registers.
+/// From an ISR or a critical section it falls back to memcpy, and with the scheduler suspended
+/// it skips the DMA, so it is safe where memcpy is but only fast in task context.
+/// @param dest pointer to the buffer to copy to
+/// @param src pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @return \p dest, like memcpy
+void* fast_memcpy(void* dest, const void* src, size_t size);
+
+/// @brief Copies \p size bytes from \p src to \p dest, which may overlap, like memmove.
+/// Falls back to memmove from an ISR or a critical section, like fast_memcpy().
+/// Uses the PIE kernels in whichever direction is safe, where newlib's memmove copies byte
+/// by byte backward, and forward whenever the buffers are misaligned.
+/// @param dest pointer to the buffer to copy to
+/// @param src pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @return \p dest, like memmove
+void* fast_memmove(void* dest, const void* src, size_t size);
+
+/// @brief Sets \p size bytes at \p dest to \p value using the fastest kernel for the memory involved.
+/// Falls back to memset from an ISR or a critical section, like fast_memcpy().
+/// @param dest pointer to the buffer to fill
+/// @param value the byte value to fill with, converted to \c uint8_t like memset
+/// @param size amount of memory to fill
+/// @return \p dest, like memset
+void* fast_memset(void* dest, int value, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
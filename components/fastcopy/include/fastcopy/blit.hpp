@@ -0,0 +1,64 @@
+/*
+* 2D copy (blit) kernels: \p height rows of \p width bytes, with independent
+* source and destination strides, e.g. a rectangle from a framebuffer into a line buffer.
+*
+* Widths and strides are in bytes. Rows must not overlap.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "fastcopy.h"
+
+namespace fastcopy {
+
+/// @brief Copies a rectangle with one memcpy per row
+/// @param dest pointer to the first row to copy to
+/// @param source pointer to the first row to copy from
+/// @param width bytes per row
+/// @param height number of rows
+/// @param destStride bytes from the start of one destination row to the next
+/// @param sourceStride bytes from the start of one source row to the next
+void copy_2d_memcpy(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride);
+
+#if FASTCOPY_HAS_PIE
+
+/// @brief Copies a rectangle using the ESP32-S3 PIE 128-bit instructions.
+/// When the pointers, strides and width are all multiples of 16 bytes each row is one zero-overhead
+/// loop of the 32 byte copy, with the row advance folded into the pointer updates. Otherwise each
+/// row is copied by copy_pie_unaligned().
+/// @param dest pointer to the first row to copy to
+/// @param source pointer to the first row to copy from
+/// @param width bytes per row
+/// @param height number of rows
+/// @param destStride bytes from the start of one destination row to the next
+/// @param sourceStride bytes from the start of one source row to the next
+void copy_2d_pie(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride);
+
+#endif
+
+#if FASTCOPY_HAS_DMA
+
+/// @brief Copies a rectangle using the shared DmaService and waits for it to complete.
+/// A contiguous rectangle is one transfer. Otherwise every row is queued as a request of its own, so
+/// the rows follow each other without waiting on the CPU. Cache maintenance is done per row, as in copy_dma().
+/// @param dest pointer to the first row to copy to
+/// @param source pointer to the first row to copy from
+/// @param width bytes per row
+/// @param height number of rows
+/// @param destStride bytes from the start of one destination row to the next
+/// @param sourceStride bytes from the start of one source row to the next
+/// @return ESP_OK if successful. Otherwise an error code from the driver
+esp_err_t copy_2d_dma(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride);
+
+/// @brief Checks whether copy_2d_dma() can be used for the given rectangle: every row must meet dma_capable()
+bool dma_capable_2d(const void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride);
+
+#endif
+
+} // namespace fastcopy
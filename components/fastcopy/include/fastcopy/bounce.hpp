@@ -0,0 +1,81 @@
+/*
+* PSRAM->PSRAM copies staged through internal RAM tiles.
+*
+* A direct copy alternates a read miss and a write-back on the same cache and
+* SPI bus line by line. Staging reads a whole tile into internal RAM first and
+* then writes it out and back in one go, so the bus switches direction once per
+* tile. Either leg can be handed to the DMA, which then overlaps with the CPU
+* working on the other tile.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+namespace fastcopy {
+
+class BufferPool;
+
+/// @brief Which leg of a bounce copy the DMA does
+enum class BounceDma {
+    /// @brief The CPU reads each tile in and writes it out, then writes the destination back from the cache
+    None,
+    /// @brief The DMA fetches the next tile while the CPU writes out the current one. The source must be cache line aligned.
+    Read,
+    /// @brief The DMA writes out the previous tile while the CPU reads in the next one. The destination must be cache line aligned.
+    Write,
+};
+
+/// @brief Timing of a BounceCopy::copy(), in CPU cycles
+struct BounceStats {
+    uint32_t tiles;
+    /// @brief copy() from start to finish
+    uint32_t totalCycles;
+    /// @brief Time the CPU spent on its leg, including the cache write-back
+    uint32_t cpuCycles;
+    /// @brief Time the CPU waited for the DMA
+    uint32_t waitCycles;
+};
+
+class BounceCopy {
+public:
+    BounceCopy() = default;
+    BounceCopy(const BounceCopy&) = delete;
+    BounceCopy& operator=(const BounceCopy&) = delete;
+    ~BounceCopy() { stop(); }
+
+    /// @brief Allocates the two tiles in DMA capable internal RAM. Does nothing if already started.
+    /// @param tileSize bytes per tile, rounded up to the cache line size
+    /// @param dma which leg the shared DmaService does. It must be started for anything but BounceDma::None.
+    /// @param pool if given, the tiles are acquired from this pool instead of the heap
+    esp_err_t start(size_t tileSize, BounceDma dma = BounceDma::None, BufferPool* pool = nullptr);
+
+    /// @brief Frees the tiles, or returns them to their pool
+    void stop();
+
+    bool started() const { return tiles[0] != nullptr; }
+
+    size_t tileSize() const { return size; }
+
+    /// @brief Copies \p length bytes tile by tile, leaving the destination written back to PSRAM.
+    /// Uses the calling task's DmaService::NOTIFY_INDEX notification for the DMA completions.
+    /// @return ESP_OK if successful, ESP_ERR_INVALID_ARG if the DMA leg's buffer isn't cache line aligned.
+    /// Otherwise an error code from the DMA
+    esp_err_t copy(void* dest, const void* source, size_t length);
+
+    /// @brief The timing of the last copy()
+    const BounceStats& stats() const { return counters; }
+
+private:
+    void* tiles[2] = {};
+    size_t size = 0;
+    BounceDma leg = BounceDma::None;
+    BufferPool* tilePool = nullptr;
+    BounceStats counters = {};
+};
+
+} // namespace fastcopy
@@ -0,0 +1,196 @@
+/*
+* PSRAM cache helpers shared by the fastcopy kernels and the memorycopy benchmark.
+*
+* Only available on targets with an MMU-mapped external memory (the ESP32-S3).
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_cache.h"
+#include "hal/mmu_hal.h"
+#include "rom/cache.h"
+
+#include "fastcopy/pie.hpp"
+
+namespace fastcopy {
+
+namespace internal {
+
+    inline uint16_t cacheLineSize;
+
+    // Cache control directly via functions provided in ROM.
+    // Don't try this at home! Always use the public APIs prescribed by Espressif.
+
+    static inline void fetchCacheLineSize() {
+        struct cache_mode cm;
+        cm.icache = 0; // data cache
+        Cache_Get_Mode(&cm);
+        cacheLineSize = cm.cache_line_size;
+    }
+
+    static inline uint32_t getCacheLineSize() {
+        if(cacheLineSize == 0) [[unlikely]] {
+            fetchCacheLineSize();
+        }
+        return cacheLineSize;
+    }
+
+    template<auto OP>
+    static inline void onRange(void* addr, size_t size) {
+        const uint32_t ls = getCacheLineSize();
+        const uint32_t off = ((uint32_t)addr) & (ls-1);
+        const uint32_t start = ((uint32_t)addr - off);
+        const uint32_t lines = (size + off + (ls-1)) / ls;
+        OP(start,lines);
+    }
+
+    static inline void writeBack(void* addr, size_t size) {
+        onRange<Cache_WriteBack_Items>(addr,size);
+    }
+
+    static inline void invalidate(void* addr, size_t size) {
+        onRange<Cache_Invalidate_DCache_Items>(addr,size);
+    }
+
+    static inline void invalidateCache() {
+        Cache_Invalidate_DCache_All();
+    }
+
+    static inline void clean(void* addr, size_t size) {
+        onRange<Cache_Clean_Items>(addr,size);
+    }
+
+    static inline void cleanCache() {
+        Cache_Clean_All();
+    }
+
+    // Asynchronous preload of a range into the data cache. Only one preload can run
+    // at a time, and each one has to be ended with the value preloadStart() returned,
+    // which restores the cache's autoload setting.
+
+    static inline uint32_t preloadStart(const void* addr, size_t size) {
+        return Cache_Start_DCache_Preload((uint32_t)addr, size, 0); // 0: ascending addresses
+    }
+
+    static inline bool preloadDone() {
+        return Cache_DCache_Preload_Done() != 0;
+    }
+
+    static inline void preloadEnd(uint32_t autoload) {
+        Cache_End_DCache_Preload(autoload);
+    }
+}
+
+/**
+ * @brief Flush and invalidate a memory region from the cache.
+ *
+ * @param addr
+ * @param size
+ * @return true
+ * @return false
+ */
+static inline bool flushCache(void* const addr, const size_t size) {
+    return esp_cache_msync(addr,size,ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA) == ESP_OK;
+    // internal::writeBack(addr,size);
+    // return true;
+}
+
+/**
+ * @brief Invalidate a memory region from the cache.
+ *
+ * @param addr
+ * @param size
+ * @return true
+ * @return false
+ */
+static inline bool invalidateCache(void* const addr, const size_t size) {
+    return esp_cache_msync(addr,size,ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA) == ESP_OK;
+    // internal::invalidate(addr,size);
+    // return true;
+}
+
+static inline void invalidateCache() {
+    internal::invalidateCache();
+}
+
+/**
+ * @brief Remove data to be overwritte from the cache.
+ *
+ * @param addr
+ * @param size
+ * @return true
+ * @return false
+ */
+static inline bool uncacheForWrite(void* const addr, const size_t size) {
+    return invalidateCache(addr,size);
+    // internal::clean(addr,size);
+    return true;
+}
+
+static inline bool uncacheForWrite() {
+    internal::cleanCache();
+    return true;
+}
+
+/**
+ * @brief Remove data to be read from the cache.
+ *
+ * @param addr
+ * @param size
+ * @return true
+ * @return false
+ */
+static inline bool uncacheForRead(void* const addr, const size_t size) {
+    return flushCache(addr,size) && invalidateCache(addr,size);
+}
+
+static inline bool isExtMem(const void* const addr) {
+    return mmu_hal_check_valid_ext_vaddr_region(0, (uint32_t)addr, 1, MMU_VADDR_DATA );
+}
+
+
+static inline void INL compiler_mem_barrier(void* const addr, const size_t size) {
+    /* Let the compiler know that
+        a) we need all data actually written to memory at addr before this point, and
+        b) it cannot make any assumptions about the memory content at addr after this point.
+    */
+    asm volatile("":"+m" (*(uint8_t(*)[size])addr));
+}
+
+
+/**
+ * @brief Preps the cache for both \p dest and \p src by flushing & invalidating any cached data.
+ *
+ * @param dest destination where data will be subsequently written to
+ * @param src source where data will be subsequently read from
+ * @param size size in bytes of the \p dest and \p src memory regions
+ * @param useCache whether to use the cache. If \c false, this function does nothing
+ * @return true \p dest \e is cached memory and was successfully invalidated from the cache
+ * @return false \p dest is \e not cached memory
+ */
+static inline bool prepareCache(void* const dest, void* const src, const size_t size, const bool useCache)
+{
+
+    compiler_mem_barrier(src,size);
+
+    // Do nothing if we're not using the cache
+    if (! useCache)
+        return false;
+
+    if(isExtMem(src)) {
+        // ESP_LOGI(TAG, "SRC is ext.");
+        uncacheForRead(src,size);
+    }
+    if(isExtMem(dest)) {
+        // ESP_LOGI(TAG, "DEST is ext.");
+        return uncacheForWrite(dest,size);
+    } else {
+        return false;
+    }
+}
+
+} // namespace fastcopy
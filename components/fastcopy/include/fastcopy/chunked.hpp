@@ -0,0 +1,84 @@
+/*
+* Large DMA copies split into chunks.
+*
+* async_memcpy allocates the descriptors for a transfer when it is submitted,
+* one pair per ~4KB, from internal DMA capable RAM. A single multi-MB transfer
+* therefore needs tens of KB of internal RAM at once, and its cache write-back
+* all has to happen before the DMA may start. ChunkedDma submits a transfer as
+* fixed size chunks instead, with a bounded number in flight, and does the
+* cache maintenance of each chunk while the chunks before it are being copied.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "fastcopy/dma_service.hpp"
+
+namespace fastcopy {
+
+/// @brief Settings for a ChunkedDma
+struct ChunkedDmaConfig {
+    /// @brief Bytes per chunk, rounded down to the cache line size
+    size_t chunkSize;
+    /// @brief Maximum number of chunks in flight
+    uint32_t depth;
+};
+
+/// @brief Timing of a ChunkedDma::copy(), in CPU cycles
+struct ChunkedDmaStats {
+    uint32_t chunks;
+    /// @brief copy() from start to finish
+    uint32_t totalCycles;
+    /// @brief Time the CPU spent on cache maintenance and submitting chunks
+    uint32_t cpuCycles;
+    /// @brief Time the CPU waited for chunks to complete
+    uint32_t waitCycles;
+};
+
+class ChunkedDma {
+public:
+    ChunkedDma() = default;
+    ChunkedDma(const ChunkedDma&) = delete;
+    ChunkedDma& operator=(const ChunkedDma&) = delete;
+    ~ChunkedDma() { stop(); }
+
+    /// @brief Installs its own DmaService with room for \p config.depth chunks. Does nothing if already started.
+    esp_err_t start(const ChunkedDmaConfig& config);
+
+    /// @brief Waits for all chunks to complete and uninstalls the DMA service
+    void stop();
+
+    bool started() const { return service.started(); }
+
+    size_t chunkSize() const { return chunk; }
+
+    /// @brief Copies \p size bytes chunk by chunk and waits for the last one.
+    /// Handles the cache for buffers in PSRAM, which must be aligned to the cache line size
+    /// in both address and size, like copy_dma().
+    /// @return ESP_OK if successful, ESP_ERR_INVALID_ARG if the buffers can't be DMA'd.
+    /// Otherwise an error code from the driver
+    esp_err_t copy(void* dest, const void* source, size_t size);
+
+    /// @brief The timing of the last copy()
+    const ChunkedDmaStats& stats() const { return counters; }
+
+    /// @brief The counters of the underlying DmaService, over all copies since start()
+    DmaServiceStats serviceStats() const { return service.stats(); }
+
+private:
+    DmaService service;
+    SemaphoreHandle_t done = nullptr;
+    size_t chunk = 0;
+    uint32_t depth = 0;
+    ChunkedDmaStats counters = {};
+};
+
+} // namespace fastcopy
@@ -0,0 +1,49 @@
+/*
+* Buffer comparison and checksums, for checking copies and for spotting buffers
+* which have changed.
+*
+* Portable, with a PIE fast path on the ESP32-S3.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fastcopy.h"
+
+namespace fastcopy {
+
+/// @brief Checks whether two buffers hold the same bytes, like <tt>memcmp(a, b, size) == 0</tt>.
+/// When \p a and \p b share the same offset from a 16-byte boundary the bulk is compared with
+/// PIE 128-bit loads, XOR and OR, checking for a difference every kilobyte.
+/// @param a pointer to the first buffer
+/// @param b pointer to the second buffer
+/// @param size amount of memory to compare
+/// @return \c true if all \p size bytes are equal
+bool equal(const void* a, const void* b, size_t size);
+
+/// @brief A 64-bit Fletcher-style checksum over 32-bit words: the low half is the sum of the words,
+/// the high half the sum of those running sums, so it also changes when data moves within the buffer.
+/// Checksums of the same bytes only match when the buffers have the same alignment mod 4.
+/// @param data pointer to the buffer
+/// @param size amount of memory to checksum
+uint64_t checksum(const void* data, size_t size);
+
+/// @brief The standard CRC-32 (IEEE 802.3, as zlib's crc32()), from the table driven
+/// esp_rom_crc32_le() in ROM where there is one. Pass the previous result as \p crc to continue it.
+/// Slower than checksum() but independent of alignment and a far stronger check.
+/// @param data pointer to the buffer
+/// @param size amount of memory to checksum
+/// @param crc the CRC of the data before \p data, 0 to start
+uint32_t crc32(const void* data, size_t size, uint32_t crc = 0);
+
+/// @brief Dirty check: checksums the buffer and compares the result with \p sum, which is then updated.
+/// @param data pointer to the buffer
+/// @param size amount of memory to check
+/// @param sum the checksum from the previous check, 0 on the first
+/// @return \c true if the buffer has changed since the checksum in \p sum was taken
+bool changed(const void* data, size_t size, uint64_t& sum);
+
+} // namespace fastcopy
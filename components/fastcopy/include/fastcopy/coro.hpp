@@ -0,0 +1,250 @@
+/*
+* C++20 coroutines for asynchronous copies.
+*
+* A Task is a coroutine that can co_await a copy: it is suspended when the copy
+* is submitted and resumed once the DMA has finished, so a sequence of copies
+* and the work in between reads as straight code instead of a callback state
+* machine, and waiting costs a heap allocated coroutine frame instead of a task
+* stack.
+*
+* The DMA completion runs in an ISR, where a coroutine must not be resumed. The
+* completion callback therefore only posts the coroutine to an Executor, which
+* resumes it on the task (or host thread) running the executor. Any number of
+* Tasks can be spawned on one executor and be waiting for copies at once.
+*
+* Everything in here is portable. The FreeRTOS executor and the DMA engine are
+* in this header too but only exist on targets with async_memcpy;
+* fastcopy/coro_host.hpp has an executor and a fake DMA for the host.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <exception>
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#include "fastcopy.h"
+
+#if FASTCOPY_HAS_DMA
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#endif
+
+namespace fastcopy {
+
+class Task;
+
+/// @brief Resumes coroutines posted to it, on the task or thread that runs it
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /// @brief Queues \p h to be resumed by the executor. Must be safe to call from the DMA completion.
+    /// @return whether a higher priority task was woken, as a DmaDoneCallback returns it
+    virtual bool post(std::coroutine_handle<> h) = 0;
+
+    /// @brief Hands \p task over to the executor, which starts it and frees it once it has finished.
+    /// @return ESP_ERR_NO_MEM if the executor already runs as many tasks as it can
+    esp_err_t spawn(Task&& task);
+
+    /// @brief Number of spawned tasks that haven't finished yet
+    uint32_t pending() const { return live.load(); }
+
+protected:
+    /// @brief Most tasks spawned at once, 0 for no limit
+    uint32_t maxTasks = 0;
+    std::atomic<uint32_t> live{0};
+
+    friend class Task;
+};
+
+/// @brief A coroutine returning an esp_err_t. It starts when it is co_awaited or spawned.
+class Task {
+public:
+    struct promise_type {
+        esp_err_t result = ESP_OK;
+        /// @brief The coroutine awaiting this one, if any
+        std::coroutine_handle<> continuation;
+        /// @brief The executor this was spawned on, which then owns it
+        Executor* executor = nullptr;
+
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                promise_type& p = h.promise();
+                if(p.continuation) {
+                    return p.continuation;
+                }
+                if(p.executor) {
+                    Executor* const executor = p.executor;
+                    h.destroy();
+                    executor->live--;
+                }
+                return std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_value(esp_err_t r) noexcept { result = r; }
+        // Built without exceptions on the target, there is nothing to pass on.
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&) = delete;
+    ~Task() { if(handle) handle.destroy(); }
+
+    /// @brief Runs the task to completion, resuming the awaiting coroutine afterwards
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() const noexcept { return h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+            esp_err_t await_resume() const noexcept { return h.promise().result; }
+        };
+        return Awaiter{ handle };
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+
+    friend class Executor;
+};
+
+inline esp_err_t Executor::spawn(Task&& task)
+{
+    if(maxTasks != 0 && live.load() >= maxTasks) {
+        return ESP_ERR_NO_MEM;
+    }
+    std::coroutine_handle<Task::promise_type> h = task.handle;
+    task.handle = nullptr;
+    h.promise().executor = this;
+    live++;
+    post(h);
+    return ESP_OK;
+}
+
+
+/// @brief Anything that can start a copy and call back when it is done, like DmaService::submit()
+template<typename E>
+concept CopyEngine = requires(E& engine, void* dest, const void* source, size_t size, bool (*cb)(void*), void* arg) {
+    { engine.submit(dest, source, size, cb, arg) } -> std::same_as<esp_err_t>;
+};
+
+/// @brief co_await'ing this submits a copy to \p Engine and suspends the coroutine until the
+/// copy is done. If the engine has a <tt>finish(dest, size)</tt> it is called before resuming.
+/// @return the error from submitting, or ESP_OK
+template<CopyEngine Engine>
+class CopyAwaitable {
+public:
+    CopyAwaitable(Executor& executor, Engine& engine, void* dest, const void* source, size_t size)
+        : executor(executor), engine(engine), dest(dest), source(source), size(size) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle = h;
+        // The completion may resume the coroutine before submit() even returns, after which
+        // this object must not be touched; only a failed submit leaves it to us.
+        const esp_err_t r = engine.submit(dest, source, size, &onDone, this);
+        if(r != ESP_OK) {
+            result = r;
+            return false;
+        }
+        return true;
+    }
+
+    esp_err_t await_resume() {
+        if constexpr (requires { engine.finish(dest, size); }) {
+            if(result == ESP_OK) {
+                engine.finish(dest, size);
+            }
+        }
+        return result;
+    }
+
+private:
+    static IRAM_ATTR bool onDone(void* arg) {
+        CopyAwaitable* const self = (CopyAwaitable*)arg;
+        return self->executor.post(self->handle);
+    }
+
+    Executor& executor;
+    Engine& engine;
+    void* dest;
+    const void* source;
+    size_t size;
+    std::coroutine_handle<> handle;
+    esp_err_t result = ESP_OK;
+};
+
+/// @brief Copies through \p engine, resuming on \p executor
+template<CopyEngine Engine>
+CopyAwaitable<Engine> copyAsync(Executor& executor, Engine& engine, void* dest, const void* source, size_t size)
+{
+    return CopyAwaitable<Engine>(executor, engine, dest, source, size);
+}
+
+#if FASTCOPY_HAS_DMA
+
+/// @brief Resumes coroutines on the task calling run(), from a FreeRTOS queue that the DMA ISR can post to
+class FreeRtosExecutor : public Executor {
+public:
+    FreeRtosExecutor() = default;
+    FreeRtosExecutor(const FreeRtosExecutor&) = delete;
+    FreeRtosExecutor& operator=(const FreeRtosExecutor&) = delete;
+    ~FreeRtosExecutor() { stop(); }
+
+    /// @brief Creates the queue. Every task can have one resume queued, so \p tasks is
+    /// also the most tasks that can be spawned at once. Does nothing if already started.
+    esp_err_t start(uint32_t tasks);
+
+    /// @brief Deletes the queue. No spawned task may be left.
+    void stop();
+
+    bool started() const { return queue != nullptr; }
+
+    bool post(std::coroutine_handle<> h) override;
+
+    /// @brief Resumes posted coroutines on the calling task until every spawned task has finished
+    void run();
+
+private:
+    QueueHandle_t queue = nullptr;
+};
+
+/// @brief A CopyEngine on the shared DmaService with the cache maintenance of copy_dma(),
+/// so PSRAM buffers must be aligned to the cache line size in both address and size
+struct CachedDma {
+    esp_err_t submit(void* dest, const void* source, size_t size, bool (*cb)(void*), void* arg);
+    void finish(void* dest, size_t size);
+};
+
+/// @brief Copies on the shared DmaService like copy_dma(), resuming on \p executor
+inline CopyAwaitable<CachedDma> copyAsync(Executor& executor, void* dest, const void* source, size_t size)
+{
+    static CachedDma engine;
+    return CopyAwaitable<CachedDma>(executor, engine, dest, source, size);
+}
+
+#endif
+
+} // namespace fastcopy
@@ -0,0 +1,142 @@
+/*
+* Host side of the coroutine copies: an executor on std::mutex and a fake DMA,
+* so code written against fastcopy/coro.hpp can be run and tested on Linux.
+*
+* HostDma doesn't copy anything until told to, and then completes its requests
+* in order, calling back like the DMA ISR would. Driving it and the executor
+* from a test decides exactly when each coroutine resumes.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "fastcopy/coro.hpp"
+
+namespace fastcopy {
+
+/// @brief Resumes coroutines on the thread calling run() or poll(). post() is safe from any thread.
+class HostExecutor : public Executor {
+public:
+    /// @param tasks most tasks spawned at once, 0 for no limit
+    explicit HostExecutor(uint32_t tasks = 0) { maxTasks = tasks; }
+
+    bool post(std::coroutine_handle<> h) override {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ready.push_back(h);
+        }
+        posted.notify_one();
+        return false;
+    }
+
+    /// @brief Resumes posted coroutines until every spawned task has finished,
+    /// blocking while none is ready. Something else must complete their copies meanwhile.
+    void run() {
+        while(pending() != 0) {
+            std::coroutine_handle<> h;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                posted.wait(guard, [this]() { return !ready.empty(); });
+                h = ready.front();
+                ready.pop_front();
+            }
+            h.resume();
+        }
+    }
+
+    /// @brief Resumes the coroutines that are ready now, including any they post, without blocking
+    /// @return the number of coroutines resumed
+    size_t poll() {
+        size_t resumed = 0;
+        for(;;) {
+            std::coroutine_handle<> h;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(ready.empty()) {
+                    return resumed;
+                }
+                h = ready.front();
+                ready.pop_front();
+            }
+            h.resume();
+            resumed++;
+        }
+    }
+
+private:
+    std::mutex lock;
+    std::condition_variable posted;
+    std::deque<std::coroutine_handle<>> ready;
+};
+
+/// @brief A CopyEngine which queues copies and only does them when complete() is called
+class HostDma {
+public:
+    /// @param depth requests queued at once before submit() fails with ESP_ERR_NO_MEM, 0 for no limit
+    explicit HostDma(size_t depth = 0) : depth(depth) {}
+
+    esp_err_t submit(void* dest, const void* source, size_t size, bool (*cb)(void*), void* arg) {
+        std::lock_guard<std::mutex> guard(lock);
+        if(depth != 0 && queue.size() >= depth) {
+            return ESP_ERR_NO_MEM;
+        }
+        queue.push_back({ dest, source, size, cb, arg });
+        accepted++;
+        return ESP_OK;
+    }
+
+    /// @brief Copies and calls back for up to \p count of the oldest requests
+    /// @return the number of requests completed
+    size_t complete(size_t count = SIZE_MAX) {
+        size_t done = 0;
+        for(; done < count; done++) {
+            Request req;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if(queue.empty()) {
+                    break;
+                }
+                req = queue.front();
+                queue.pop_front();
+            }
+            memcpy(req.dest, req.source, req.size);
+            req.cb(req.arg);
+        }
+        return done;
+    }
+
+    /// @brief Requests waiting for complete()
+    size_t inFlight() {
+        std::lock_guard<std::mutex> guard(lock);
+        return queue.size();
+    }
+
+    /// @brief Requests accepted since construction
+    size_t submitted() {
+        std::lock_guard<std::mutex> guard(lock);
+        return accepted;
+    }
+
+private:
+    struct Request {
+        void* dest;
+        const void* source;
+        size_t size;
+        bool (*cb)(void*);
+        void* arg;
+    };
+
+    std::mutex lock;
+    std::deque<Request> queue;
+    size_t depth;
+    size_t accepted = 0;
+};
+
+} // namespace fastcopy
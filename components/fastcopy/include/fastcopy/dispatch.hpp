@@ -0,0 +1,120 @@
+/*
+* The decisions behind fast_memcpy(), fast_memmove() and fast_memset(), the
+* head/body/tail split the PIE kernels share, and the BufferPool size classes,
+* as plain functions of addresses and sizes.
+*
+* Nothing in here touches memory or hardware, so it builds and is tested on the
+* linux target, where the kernels it chooses between don't exist.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sdkconfig.h"
+
+namespace fastcopy {
+
+/// @brief A buffer cut into the bytes up to an aligned address, whole blocks from there, and the rest
+struct Split {
+    size_t head;
+    size_t body;
+    size_t tail;
+};
+
+/// @brief Splits \p size bytes at \p address into a head up to the next \p Align boundary (all of
+/// them if the buffer ends first), a body of whole \p Block byte blocks, and the tail left over
+template<size_t Align, size_t Block = Align>
+requires ( (Align & (Align-1)) == 0 && (Block & (Block-1)) == 0 )
+constexpr Split split(uintptr_t address, size_t size)
+{
+    size_t head = (-address) & (Align-1);
+    if(head > size) {
+        head = size;
+    }
+    const size_t body = (size - head) & ~(Block-1);
+    return { head, body, size - head - body };
+}
+
+/// @brief Whether \p size bytes at \p dest and at \p src share any byte
+constexpr bool overlaps(uintptr_t dest, uintptr_t src, size_t size)
+{
+    return dest < src + size && src < dest + size;
+}
+
+/// @brief What fast_memcpy() and its friends need to know about the buffers and the caller
+struct CopyContext {
+    bool extDest;
+    bool extSrc;
+    /// @brief Whether dma_capable() holds for the buffers
+    bool dmaCapable;
+    /// @brief Not in an ISR or a critical section, so the Q registers may be used
+    bool canUsePie;
+    /// @brief Also with the scheduler running, so the caller may wait for the DMA
+    bool canBlock;
+};
+
+enum class CopyPath {
+    Libc,
+    /// @brief copy_pie_32(): both buffers and the size are multiples of 32 bytes
+    Pie32,
+    PieUnaligned,
+    /// @brief copy_hybrid(), memcpy if that fails
+    Hybrid,
+};
+
+/// @brief The kernel fast_memcpy() runs. \p ctx.dmaCapable and \p ctx.canBlock are only
+/// consulted for PSRAM->PSRAM copies of at least CONFIG_FASTCOPY_DMA_MIN_SIZE bytes.
+constexpr CopyPath copy_path(uintptr_t dest, uintptr_t src, size_t size, const CopyContext& ctx)
+{
+    if(!ctx.canUsePie) {
+        return CopyPath::Libc;
+    }
+    if(!ctx.extDest && !ctx.extSrc) {
+        // Internal RAM: the PIE path is ~5x memcpy once its setup is amortised.
+        if(size < CONFIG_FASTCOPY_PIE_MIN_SIZE) {
+            return CopyPath::Libc;
+        }
+        return ((dest | src | size) & 0x1f) == 0 ? CopyPath::Pie32 : CopyPath::PieUnaligned;
+    }
+    if(ctx.extDest && ctx.extSrc && size >= CONFIG_FASTCOPY_DMA_MIN_SIZE && ctx.dmaCapable && ctx.canBlock) {
+        return CopyPath::Hybrid;
+    }
+    // Anything else touching PSRAM is bound by the PSRAM bus; memcpy is as good as any.
+    return CopyPath::Libc;
+}
+
+enum class MovePath {
+    /// @brief The buffers don't overlap: fast_memcpy()
+    Copy,
+    /// @brief move_pie()
+    Pie,
+    Libc,
+};
+
+/// @brief The kernel fast_memmove() runs
+constexpr MovePath move_path(uintptr_t dest, uintptr_t src, size_t size, bool canUsePie)
+{
+    if(!overlaps(dest, src, size)) {
+        return MovePath::Copy;
+    }
+    return size >= CONFIG_FASTCOPY_PIE_MIN_SIZE && canUsePie ? MovePath::Pie : MovePath::Libc;
+}
+
+/// @brief Whether fast_memset() runs fill_pie() rather than memset
+constexpr bool fill_uses_pie(size_t size, bool extDest, bool canUsePie)
+{
+    return size >= CONFIG_FASTCOPY_PIE_MIN_SIZE && !extDest && canUsePie;
+}
+
+/// @brief The smallest BufferPool size class, of sizes \p minSize, 2 * \p minSize, 4 * \p minSize..., that \p size fits
+constexpr uint32_t size_class(size_t size, size_t minSize)
+{
+    // ceil(log2(ceil(size / minSize))), without overflowing for sizes close to SIZE_MAX
+    const size_t units = size / minSize + (size % minSize != 0);
+    return units <= 1 ? 0 : sizeof(unsigned long) * 8 - __builtin_clzl((unsigned long)(units - 1));
+}
+
+} // namespace fastcopy
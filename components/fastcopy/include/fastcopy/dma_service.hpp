@@ -0,0 +1,161 @@
+/*
+* A long-lived async_memcpy (GDMA) copy service.
+*
+* The driver is installed once, and copy requests are queued straight into the
+* driver's backlog. Callers are told about completion through a callback (in ISR
+* context) or a task notification, so nothing blocks unless asked to.
+*
+* Notifications use their own index, DmaService::NOTIFY_INDEX, so a completion
+* left pending can't satisfy someone else's ulTaskNotifyTake() on the same task.
+*
+* The service does no cache maintenance; see copy_dma() for a blocking copy that does.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_async_memcpy.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#if configTASK_NOTIFICATION_ARRAY_ENTRIES < 2
+#error "fastcopy needs CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES of at least 2 for DmaService completions"
+#endif
+
+namespace fastcopy {
+
+/// @brief Completion callback, running in ISR context
+/// @param arg the argument given to DmaService::submit()
+/// @return whether a higher priority task was woken
+typedef bool (*DmaDoneCallback)(void* arg);
+
+/// @brief Settings for a DmaService
+struct DmaServiceConfig {
+    /// @brief Maximum number of requests queued in the driver at once
+    uint32_t depth;
+    /// @brief Address and size alignment required for PSRAM buffers, normally the cache line size
+    uint32_t psramAlign;
+};
+
+/// @brief Timing counters of a DmaService, in CPU cycles
+struct DmaServiceStats {
+    /// @brief Time taken by start() to install the driver
+    uint32_t setupCycles;
+    /// @brief Number of requests submitted and completed
+    uint32_t submitted;
+    uint32_t completed;
+    /// @brief Time spent inside submit(), including waiting for a free slot
+    uint64_t submitCycles;
+    uint32_t maxSubmitCycles;
+    /// @brief Time from submission to completion, summed over all requests
+    uint64_t latencyCycles;
+    /// @brief Bytes copied by completed requests
+    uint64_t bytes;
+    /// @brief Time during which at least one request was in flight
+    uint64_t busyCycles;
+};
+
+class DmaService {
+public:
+    /// @brief Task notification index of the completions of submit(..., TaskHandle_t)
+    static const UBaseType_t NOTIFY_INDEX = 1;
+
+    DmaService() = default;
+    DmaService(const DmaService&) = delete;
+    DmaService& operator=(const DmaService&) = delete;
+    ~DmaService() { stop(); }
+
+    /// @brief Installs the async_memcpy driver. Does nothing if already started.
+    esp_err_t start(const DmaServiceConfig& config);
+
+    /// @brief Waits for all requests to complete and uninstalls the driver
+    void stop();
+
+    bool started() const { return handle != nullptr; }
+
+    /// @brief Queues a copy, calling \p cb from the DMA ISR once it has completed.
+    /// Blocks while \p depth requests are already in flight.
+    esp_err_t submit(void* dest, const void* source, size_t size, DmaDoneCallback cb, void* arg);
+
+    /// @brief Queues a copy, notifying \p task on NOTIFY_INDEX once it has completed.
+    /// The notification value is the CPU cycle count at completion (eSetValueWithOverwrite).
+    esp_err_t submit(void* dest, const void* source, size_t size, TaskHandle_t task);
+
+    /// @brief Waits for a completion notified to the calling task, and clears it
+    /// @return the CPU cycle count at completion
+    static uint32_t waitNotified();
+
+    /// @brief Copies and waits for completion
+    esp_err_t copy(void* dest, const void* source, size_t size) { return copy(dest, source, size, []() {}); }
+
+    /// @brief Copies, running \p meanwhile on the calling task while the DMA works, and waits for completion.
+    /// \p meanwhile only runs if the copy was submitted.
+    template<typename F>
+    esp_err_t copy(void* dest, const void* source, size_t size, F&& meanwhile);
+
+    /// @brief DmaDoneCallback giving the binary or counting semaphore passed as \p arg
+    static bool giveSemaphoreFromIsr(void* arg);
+
+    /// @brief Waits until no requests are in flight
+    void waitIdle();
+
+    /// @brief A snapshot of the timing counters
+    DmaServiceStats stats() const;
+
+    /// @brief Zeroes the timing counters, except setupCycles
+    void resetStats();
+
+private:
+    struct Request {
+        DmaService* service;
+        DmaDoneCallback cb;
+        void* arg;
+        TaskHandle_t task;
+        size_t size;
+        uint32_t start;
+        bool busy;
+    };
+
+    static bool IRAM_ATTR onDone(async_memcpy_t, async_memcpy_event_t*, void* args);
+    esp_err_t submitRequest(void* dest, const void* source, size_t size, DmaDoneCallback cb, void* arg, TaskHandle_t task);
+
+    async_memcpy_t handle = nullptr;
+    Request* requests = nullptr;
+    uint32_t depth = 0;
+    uint32_t inFlight = 0;
+    uint32_t busyStart = 0;
+    SemaphoreHandle_t slots = nullptr;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    DmaServiceStats counters = {};
+};
+
+template<typename F>
+IRAM_ATTR esp_err_t DmaService::copy(void* dest, const void* source, size_t size, F&& meanwhile)
+{
+    StaticSemaphore_t doneBuffer;
+    SemaphoreHandle_t done = xSemaphoreCreateBinaryStatic(&doneBuffer);
+
+    const esp_err_t r = submit(dest, source, size, &giveSemaphoreFromIsr, (void*)done);
+    if(r == ESP_OK) {
+        meanwhile();
+        // No timeout: the callback references the semaphore on our stack, so we must not leave before it ran.
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+    vSemaphoreDelete(done);
+    return r;
+}
+
+/// @brief The service shared by copy_dma() and fast_memcpy(), started on first use
+/// with a depth of CONFIG_FASTCOPY_DMA_BACKLOG. Until it starts, every call tries again.
+/// @param[out] service receives the running service, or \c nullptr
+/// @return \c ESP_OK, or the error from DmaService::start()
+esp_err_t dmaService(DmaService** service);
+
+} // namespace fastcopy
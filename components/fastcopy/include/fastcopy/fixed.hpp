@@ -0,0 +1,90 @@
+/*
+* Fixed-size copies: copy<N>() expands to a straight-line sequence of loads and
+* stores for a size known at compile time, with no loop and no call.
+*
+* Meant for small structs and messages, where memcpy's call, size checks and
+* loop setup take longer than the copy itself.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <utility>
+
+#include "esp_attr.h"
+
+#include "fastcopy.h"
+
+#if FASTCOPY_HAS_PIE
+#include "fastcopy/unroll.hpp"
+#endif
+
+#ifndef INL
+#define INL __attribute__((always_inline))
+#endif
+
+namespace fastcopy {
+
+namespace internal {
+
+    template<typename T, size_t... I>
+    static IRAM_ATTR inline void INL copy_elements(void* dest, const void* source, std::index_sequence<I...>) {
+        T* d = (T*)dest;
+        const T* s = (const T*)source;
+        ((d[I] = s[I]), ...);
+    }
+
+#if FASTCOPY_HAS_PIE
+    /// @brief \p B 16-byte blocks, at most 8 Q registers at a time
+    template<size_t B>
+    static IRAM_ATTR inline void INL copy_blocks(const void*& src_p, void*& dest_p) {
+        if constexpr (B > 8) {
+            pie_block<PieSchedule::Staggered, 8>(src_p, dest_p, std::make_integer_sequence<uint8_t, 8>{});
+            copy_blocks<B - 8>(src_p, dest_p);
+        } else if constexpr (B > 0) {
+            pie_block<PieSchedule::Staggered, B>(src_p, dest_p, std::make_integer_sequence<uint8_t, B>{});
+        }
+    }
+#endif
+
+}
+
+/// @brief Copies \p N bytes with straight-line code.
+/// With 16-byte alignment the 16-byte blocks are copied with PIE loads and stores (staggered, up to 8
+/// Q registers), with 4-byte alignment by 32-bit loads and stores; what is left is copied in smaller pieces.
+/// Without either alignment it is left to the compiler's built-in memcpy.
+/// @tparam N amount of memory to copy
+/// @tparam Align the alignment guaranteed for both \p dest and \p source
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+template<size_t N, size_t Align = 4>
+static IRAM_ATTR inline void INL copy(void* dest, const void* source)
+{
+    if constexpr (N == 0) {
+        return;
+    } else if constexpr (FASTCOPY_HAS_PIE && Align >= 16 && N >= 16) {
+#if FASTCOPY_HAS_PIE
+        const void* src_p = source;
+        void* dest_p = dest;
+        internal::copy_blocks<N / 16>(src_p, dest_p);
+        copy<N % 16, Align>(dest_p, src_p);
+#endif
+    } else if constexpr (Align >= 4 && N >= 4) {
+        constexpr size_t done = N & ~(size_t)3;
+        internal::copy_elements<uint32_t>(dest, source, std::make_index_sequence<N / 4>{});
+        copy<N % 4, Align>((uint8_t*)dest + done, (const uint8_t*)source + done);
+    } else if constexpr (Align >= 2 && N >= 2) {
+        constexpr size_t done = N & ~(size_t)1;
+        internal::copy_elements<uint16_t>(dest, source, std::make_index_sequence<N / 2>{});
+        copy<N % 2, Align>((uint8_t*)dest + done, (const uint8_t*)source + done);
+    } else if constexpr (Align >= 2) {
+        *(uint8_t*)dest = *(const uint8_t*)source;
+    } else {
+        __builtin_memcpy(dest, source, N);
+    }
+}
+
+} // namespace fastcopy
@@ -0,0 +1,52 @@
+/*
+* Hybrid copy: one transfer split between the GDMA and the CPU, both running at once.
+*
+* The DMA takes the first part of the buffer and the CPU copies the rest while
+* waiting for it. The split ("share") is given out of 256 and is kept per region
+* pair, set either by hand or by hybrid_calibrate().
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+namespace fastcopy {
+
+/// @brief The share is out of this, i.e. HYBRID_SHARE_MAX is DMA only
+static constexpr uint32_t HYBRID_SHARE_MAX = 256;
+
+/// @brief Number of shares tried by hybrid_calibrate(), evenly spaced from CPU only to DMA only
+static constexpr uint32_t HYBRID_CALIBRATION_POINTS = 17;
+
+/// @brief Copies the first \p dmaShare / 256 of the buffer by DMA while the CPU copies the rest.
+/// The split is rounded down to a cache line. If the DMA can't be used for these buffers the CPU copies everything.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @param dmaShare the part of the buffer copied by DMA, out of HYBRID_SHARE_MAX
+/// @return ESP_OK if successful. Otherwise an error code from the DMA
+esp_err_t copy_hybrid(void* dest, const void* source, size_t size, uint32_t dmaShare);
+
+/// @brief Copies using the share stored for the buffers' region pair
+esp_err_t copy_hybrid(void* dest, const void* source, size_t size);
+
+/// @brief The share stored for the region pair of \p dest and \p source
+uint32_t hybrid_share(const void* dest, const void* source);
+
+/// @brief Stores the share to use for the region pair of \p dest and \p source
+void hybrid_set_share(const void* dest, const void* source, uint32_t dmaShare);
+
+/// @brief Times copy_hybrid() for HYBRID_CALIBRATION_POINTS shares, stores the fastest for the region pair and returns it.
+/// Each run includes writing the CPU part back from the cache, so PSRAM destinations are compared fairly.
+/// @param dest pointer to a buffer to copy to, which is overwritten
+/// @param source pointer to a buffer to copy from
+/// @param size amount of memory to copy
+/// @param cycles optional, receives the CPU cycles taken for each share
+/// @return the fastest share
+uint32_t hybrid_calibrate(void* dest, const void* source, size_t size, uint32_t* cycles = nullptr);
+
+} // namespace fastcopy
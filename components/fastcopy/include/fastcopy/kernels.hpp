@@ -0,0 +1,125 @@
+/*
+* The individual copy kernels behind fast_memcpy().
+*
+* These are exposed so that callers who already know their buffers' placement and
+* alignment can skip the dispatch, and so the benchmark can time each one in isolation.
+* Unless noted otherwise the kernels do no cache maintenance.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#include "fastcopy.h"
+
+namespace fastcopy {
+
+/// @brief Copies a buffer using a plain for loop over elements of type \p T
+/// @param T type of data to copy
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy, a multiple of sizeof(T)
+template<typename T>
+static IRAM_ATTR inline void copy_forloop(void* dest, const void* source, size_t size)
+{
+    const T* pSource = (const T*)source;
+    T* pDest = (T*)dest;
+    const size_t aCopies = size / sizeof(T);
+
+    for (size_t i = 0; i < aCopies; i++) {
+        pDest[i] = pSource[i];
+    }
+}
+
+#if FASTCOPY_HAS_PIE
+
+/// @brief Copies a buffer using the ESP32-S3 PIE 128-bit load/store instructions, 16 bytes per iteration
+/// @param dest pointer to the buffer to copy to, 16-byte aligned
+/// @param source pointer to the buffer to copy from, 16-byte aligned
+/// @param size amount of memory to copy. Only whole 16-byte blocks are copied.
+void copy_pie_16(void* dest, const void* source, size_t size);
+
+/// @brief Copies a buffer using the ESP32-S3 PIE 128-bit load/store instructions, 32 bytes per iteration
+/// @param dest pointer to the buffer to copy to, 16-byte aligned
+/// @param source pointer to the buffer to copy from, 16-byte aligned
+/// @param size amount of memory to copy. Only whole 32-byte blocks are copied.
+void copy_pie_32(void* dest, const void* source, size_t size);
+
+/// @brief Copies a buffer of any length and alignment using the ESP32-S3 PIE 128-bit instructions.
+/// Bytes up to the first 16-byte aligned destination address and the last partial block are copied
+/// by the CPU. A misaligned source is read with aligned loads and realigned with \c EE.SRC.Q.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+void copy_pie_unaligned(void* dest, const void* source, size_t size);
+
+/// @brief Copies between buffers that may overlap, like memmove, using the ESP32-S3 PIE 128-bit instructions.
+/// Copies forward when \p dest lies below \p source and backward otherwise, with any length and alignment.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+void move_pie(void* dest, const void* source, size_t size);
+
+/// @brief The forward half of move_pie(): safe for overlapping buffers as long as \p dest <= \p source
+void move_pie_forward(void* dest, const void* source, size_t size);
+
+/// @brief The backward half of move_pie(): walks down from the end with negative increments,
+/// safe for overlapping buffers as long as \p dest >= \p source
+void move_pie_backward(void* dest, const void* source, size_t size);
+
+/// @brief The fastest CPU-only copy for any buffers: the unaligned PIE kernel within internal RAM,
+/// memcpy as soon as PSRAM is involved (where the PIE kernels gain nothing over it)
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+void copy_cpu(void* dest, const void* source, size_t size);
+
+/// @brief Copies a buffer with copy_pie_unaligned() in steps of half of \p distance, keeping a data cache
+/// preload running up to \p distance bytes ahead of the copy so PSRAM source lines arrive before they are needed.
+/// Falls back to copy_pie_unaligned() for sources in internal RAM.
+/// @note Uses the ROM preload functions, so no other code may use the cache preload at the same time.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @param distance how far ahead of the copy to preload, in bytes. At least two cache lines.
+void copy_prefetch(void* dest, const void* source, size_t size, size_t distance = CONFIG_FASTCOPY_PREFETCH_DISTANCE);
+
+/// @brief Fills a buffer with a repeated 32-bit pattern using the ESP32-S3 PIE 128-bit stores.
+/// The pattern is broadcast into q0 with \c EE.VLDBC.32 and stored 32 bytes per iteration.
+/// @param dest pointer to the buffer to fill, 4-byte aligned
+/// @param pattern the value stored in every 32-bit word
+/// @param size amount of memory to fill. Only whole 32-bit words are filled.
+void fill_pie_32(void* dest, uint32_t pattern, size_t size);
+
+/// @brief Fills a buffer of any length and alignment with a byte value, like memset.
+/// Bytes up to the first 16-byte aligned address and the last partial word are set by the CPU.
+/// @param dest pointer to the buffer to fill
+/// @param value the byte value to fill with
+/// @param size amount of memory to fill
+void fill_pie(void* dest, uint8_t value, size_t size);
+
+#endif
+
+#if FASTCOPY_HAS_DMA
+
+/// @brief Copies a buffer using the shared DmaService and waits for it to complete.
+/// The driver is installed on first use and kept installed.
+/// Handles cache write-back/invalidation for buffers in PSRAM, which therefore must be
+/// aligned to the cache line size in both address and size.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @return ESP_OK if successful. Otherwise an error code from the driver
+esp_err_t copy_dma(void* dest, const void* source, size_t size);
+
+/// @brief Checks whether copy_dma() can be used for the given buffers
+bool dma_capable(const void* dest, const void* source, size_t size);
+
+#endif
+
+} // namespace fastcopy
@@ -0,0 +1,81 @@
+/*
+* Dual-core copy: one transfer split across worker tasks pinned to each core.
+*
+* The workers are created once and sleep on a task notification between copies,
+* so a copy costs one notification per core to start and one semaphore give per
+* core to finish. The calling task's own notifications are left alone.
+* The caller blocks while the workers copy, so the worker on the caller's own core
+* gets that core to itself.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+namespace fastcopy {
+
+/// @brief A copy kernel run by each worker on its slice
+typedef void (*CopyFunction)(void* dest, const void* source, size_t size);
+
+class ParallelCopy {
+public:
+    ParallelCopy() = default;
+    ParallelCopy(const ParallelCopy&) = delete;
+    ParallelCopy& operator=(const ParallelCopy&) = delete;
+    ~ParallelCopy() { stop(); }
+
+    /// @brief Creates one worker task pinned to each core. Does nothing if already started.
+    /// @param priority the workers' priority, which should be above any task that would otherwise run during a copy
+    /// @param stackSize the workers' stack size in bytes
+    esp_err_t start(UBaseType_t priority, uint32_t stackSize = 2048);
+
+    /// @brief Ends the worker tasks
+    void stop();
+
+    bool started() const { return workers[0].task != nullptr; }
+
+    /// @brief Splits a copy into \p cores slices and copies them at the same time, one per core.
+    /// The slices are split on cache line boundaries, so no two cores ever write to the same cache line.
+    /// Not reentrant: only one task may use a ParallelCopy at a time.
+    /// @param dest pointer to the buffer to copy to
+    /// @param source pointer to the buffer to copy from
+    /// @param size amount of memory to copy
+    /// @param cores the number of slices, from 1 (just the worker on core 0) to portNUM_PROCESSORS
+    /// @param kernel the copy run on each slice, copy_cpu() if \c nullptr
+    /// @param writeBack if \c true each worker also writes its slice of a PSRAM destination back from the cache
+    void copy(void* dest, const void* source, size_t size, uint32_t cores = portNUM_PROCESSORS,
+              CopyFunction kernel = nullptr, bool writeBack = false);
+
+    /// @brief CPU cycles the worker on \p core spent on its slice in the last copy, including the write-back
+    uint32_t sliceCycles(uint32_t core) const { return workers[core].cycles; }
+
+private:
+    struct Worker {
+        ParallelCopy* owner;
+        TaskHandle_t task;
+        void* dest;
+        const void* source;
+        size_t size;
+        uint32_t cycles;
+    };
+
+    static void run(void* arg);
+    void wake(uint32_t count);
+
+    Worker workers[portNUM_PROCESSORS] = {};
+    /// @brief Given once by each worker that has finished its slice or quit
+    SemaphoreHandle_t done = nullptr;
+    CopyFunction kernel = nullptr;
+    bool writeBack = false;
+    bool quit = false;
+};
+
+} // namespace fastcopy
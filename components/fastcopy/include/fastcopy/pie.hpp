@@ -0,0 +1,243 @@
+/*
+* Thin C++ wrappers around the ESP32-S3 PIE (Processor Instruction Extensions)
+* and the Xtensa zero-overhead loop.
+*
+* Everything in here is forced inline so it can be composed into kernels which
+* the compiler then schedules as one block.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <utility>
+#include <type_traits>
+
+#include "esp_attr.h"
+
+#define INL __attribute__((always_inline))
+
+namespace fastcopy {
+
+/**
+ * @brief Uses Xtensa's zero-overhead loop to execute a given operation a number of times.
+ * This function does \e not save/restore the LOOP registers, so if required these need to be
+ * saved&restored explicitly around the function call.
+ * @note This may fail to assemble when compiled with \c -Og or less
+ *
+ * @tparam F Type of the functor to execute
+ * @tparam Args Argument types of the functor
+ * @param cnt Number of iterations
+ * @param f The functor to invoke
+ * @param args Arguments to pass to the functor
+ */
+template<typename F, typename...Args>
+static IRAM_ATTR inline void INL rpt(const uint32_t cnt, const F& f, Args&&...args) {
+
+    bgn:
+        asm goto (
+            "LOOPNEZ %[cnt], %l[end]"
+            : /* no output*/
+            : [cnt] "r" (cnt)
+            : /* no clobbers */
+            : end
+        );
+
+            f(std::forward<Args>(args)...);
+
+
+    end:
+        /* Tell the compiler that the above code might execute more than once.
+           The begin label must be before the inital LOOP asm because otherwise
+           gcc may decide to put one-off setup code between the LOOP asm and the
+           begin label, i.e. inside the loop.
+        */
+        asm goto ("":::: bgn);
+        ;
+}
+
+/*
+    q<R> = *(src & ~0xf);
+    src += INC;
+*/
+template<uint8_t R, int16_t INC = 16, typename S>
+requires ( R <= 7 && ((INC & 0xf) == 0) && (-2048 <= INC) && (INC <= 2032) )
+static IRAM_ATTR inline void INL vld_128_ip(S*& src) {
+    asm volatile (
+        "EE.VLD.128.IP q%[reg], %[src], %[inc]"
+        : [src] "+r" (src)
+        : [reg] "i" (R),
+          [inc] "i" (INC),
+          "m" (*(const uint8_t(*)[16])src)
+        :
+    );
+}
+
+/*
+    *(dest & ~0xf) = q<R>;
+    dest += INC;
+*/
+template<uint8_t R, int16_t INC = 16, typename D>
+requires ( R <= 7 && ((INC & 0xf) == 0) && (-2048 <= INC) && (INC <= 2032) && !std::is_const_v<D> )
+static IRAM_ATTR inline void INL vst_128_ip(D*& dest) {
+    asm volatile (
+        "EE.VST.128.IP q%[reg], %[dest], %[inc]"
+        : [dest] "+r" (dest),
+          "=m" (*(uint8_t(*)[16])dest)
+        : [reg] "i" (R),
+          [inc] "i" (INC)
+        :
+    );
+}
+
+/*
+    q<R> = *(src & ~0xf);
+    SAR_BYTE = src & 0xf;
+    src += INC;
+*/
+template<uint8_t R, int16_t INC = 16, typename S>
+requires ( R <= 7 && ((INC & 0xf) == 0) && (-2048 <= INC) && (INC <= 2032) )
+static IRAM_ATTR inline void INL ld_128_usar_ip(S*& src) {
+    asm volatile (
+        "EE.LD.128.USAR.IP q%[reg], %[src], %[inc]"
+        : [src] "+r" (src)
+        : [reg] "i" (R),
+          [inc] "i" (INC),
+          "m" (*(const uint8_t(*)[16])((uintptr_t)src & ~(uintptr_t)0xf))
+        :
+    );
+}
+
+/*
+    q<D> = {q<HI>:q<LO>} >> (SAR_BYTE * 8);
+    i.e. the 16 bytes starting at byte SAR_BYTE of the 32 bytes in q<LO> followed by q<HI>.
+*/
+template<uint8_t D, uint8_t LO, uint8_t HI>
+requires ( D <= 7 && LO <= 7 && HI <= 7 )
+static IRAM_ATTR inline void INL src_q() {
+    asm volatile (
+        "EE.SRC.Q q%[d], q%[lo], q%[hi]"
+        :
+        : [d] "i" (D),
+          [lo] "i" (LO),
+          [hi] "i" (HI)
+        :
+    );
+}
+
+/*
+    q<R> = { *(uint32_t*)(src & ~0x3) } x 4;
+*/
+template<uint8_t R, typename S>
+requires ( R <= 7 )
+static IRAM_ATTR inline void INL vldbc_32(const S* src) {
+    asm volatile (
+        "EE.VLDBC.32 q%[reg], %[src]"
+        :
+        : [reg] "i" (R),
+          [src] "r" (src),
+          "m" (*(const uint32_t*)src)
+        :
+    );
+}
+
+/*
+    q<R> = 0;
+*/
+template<uint8_t R>
+requires ( R <= 7 )
+static IRAM_ATTR inline void INL zero_q() {
+    asm volatile (
+        "EE.ZERO.Q q%[reg]"
+        :
+        : [reg] "i" (R)
+        :
+    );
+}
+
+/*
+    q<D> = q<A> ^ q<B>;
+*/
+template<uint8_t D, uint8_t A, uint8_t B>
+requires ( D <= 7 && A <= 7 && B <= 7 )
+static IRAM_ATTR inline void INL xor_q() {
+    asm volatile (
+        "EE.XORQ q%[d], q%[a], q%[b]"
+        :
+        : [d] "i" (D),
+          [a] "i" (A),
+          [b] "i" (B)
+        :
+    );
+}
+
+/*
+    q<D> = q<A> | q<B>;
+*/
+template<uint8_t D, uint8_t A, uint8_t B>
+requires ( D <= 7 && A <= 7 && B <= 7 )
+static IRAM_ATTR inline void INL or_q() {
+    asm volatile (
+        "EE.ORQ q%[d], q%[a], q%[b]"
+        :
+        : [d] "i" (D),
+          [a] "i" (A),
+          [b] "i" (B)
+        :
+    );
+}
+
+/*
+    q<D> = q<A> & q<B>;
+*/
+template<uint8_t D, uint8_t A, uint8_t B>
+requires ( D <= 7 && A <= 7 && B <= 7 )
+static IRAM_ATTR inline void INL and_q() {
+    asm volatile (
+        "EE.ANDQ q%[d], q%[a], q%[b]"
+        :
+        : [d] "i" (D),
+          [a] "i" (A),
+          [b] "i" (B)
+        :
+    );
+}
+
+/*
+    q<D>.u32[i] = q<S>.u32[i] << N;
+    Sets SAR to N in the same statement, so nothing the compiler emits can come in between.
+*/
+template<uint8_t D, uint8_t S, uint8_t N>
+requires ( D <= 7 && S <= 7 && N <= 31 )
+static IRAM_ATTR inline void INL vsl_32() {
+    asm volatile (
+        "SSAI %[n] \n"
+        "EE.VSL.32 q%[d], q%[s]"
+        :
+        : [d] "i" (D),
+          [s] "i" (S),
+          [n] "i" (N)
+        :
+    );
+}
+
+/*
+    q<D>.s32[i] = q<S>.s32[i] >> N;
+    An arithmetic shift: the top bits are copies of the sign bit.
+    Sets SAR to N in the same statement, like vsl_32().
+*/
+template<uint8_t D, uint8_t S, uint8_t N>
+requires ( D <= 7 && S <= 7 && N <= 31 )
+static IRAM_ATTR inline void INL vsr_32() {
+    asm volatile (
+        "SSAI %[n] \n"
+        "EE.VSR.32 q%[d], q%[s]"
+        :
+        : [d] "i" (D),
+          [s] "i" (S),
+          [n] "i" (N)
+        :
+    );
+}
+
+} // namespace fastcopy
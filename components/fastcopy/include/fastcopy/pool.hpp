@@ -0,0 +1,120 @@
+/*
+* A pool of cache line aligned copy buffers, reserved up front.
+*
+* Buffers come in size classes, each twice the size of the one before, and each
+* class is carved out of one slab allocated by start(). Acquiring and releasing
+* a buffer pops or pushes a free list, so it takes the same time however full
+* the pool is, and the heap is never touched after start().
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#include "freertos/FreeRTOS.h"
+
+namespace fastcopy {
+
+/// @brief Settings for a BufferPool
+struct BufferPoolConfig {
+    /// @brief heap_caps flags for the slabs, e.g. MALLOC_CAP_SPIRAM or MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA
+    uint32_t caps;
+    /// @brief Size of the smallest class, rounded up to the cache line size
+    size_t minSize;
+    /// @brief Number of size classes, up to BufferPool::MAX_CLASSES
+    uint32_t classes;
+    /// @brief Number of buffers in each class
+    uint32_t buffers;
+};
+
+/// @brief Counters of a BufferPool
+struct BufferPoolStats {
+    /// @brief Bytes reserved by the slabs
+    size_t reserved;
+    uint32_t acquired;
+    uint32_t released;
+    /// @brief Requests no class had a free buffer for, or that were larger than the largest class
+    uint32_t failed;
+    /// @brief Releases of a pool buffer that wasn't acquired, e.g. released twice
+    uint32_t rejected;
+    /// @brief Requests served by a larger class because theirs was empty
+    uint32_t spilled;
+    /// @brief Buffers currently acquired, and the most there ever were
+    uint32_t inUse;
+    uint32_t peakInUse;
+    /// @brief Bytes asked for and bytes handed out by the buffers currently acquired.
+    /// The difference is lost to rounding up to the size class.
+    size_t requestedBytes;
+    size_t usedBytes;
+    size_t peakUsedBytes;
+    /// @brief Time spent in acquire() and release(), in CPU cycles
+    uint64_t acquireCycles;
+    uint32_t maxAcquireCycles;
+    uint64_t releaseCycles;
+    uint32_t maxReleaseCycles;
+};
+
+class BufferPool {
+public:
+    static const uint32_t MAX_CLASSES = 16;
+
+    BufferPool() = default;
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    ~BufferPool() { stop(); }
+
+    /// @brief Allocates the slabs. Does nothing if already started.
+    esp_err_t start(const BufferPoolConfig& config);
+
+    /// @brief Frees the slabs. Buffers still acquired become invalid.
+    void stop();
+
+    bool started() const { return classCount != 0; }
+
+    /// @brief Takes a buffer of at least \p size bytes from the smallest class that has one free
+    /// @return the buffer, cache line aligned, or \c nullptr if there is none or \p size is 0 or above maxSize()
+    void* acquire(size_t size);
+
+    /// @brief Returns a buffer to its class
+    /// @return \c false if \p buffer doesn't belong to this pool, or isn't currently acquired from it
+    bool release(void* buffer);
+
+    /// @brief Checks whether \p buffer lies in one of this pool's slabs
+    bool owns(const void* buffer) const;
+
+    /// @brief Size of the largest buffer the pool hands out
+    size_t maxSize() const { return classCount ? sizeClasses[classCount-1].size : 0; }
+
+    /// @brief A snapshot of the counters
+    BufferPoolStats stats() const;
+
+    /// @brief Zeroes the counters, except those describing the buffers currently acquired
+    void resetStats();
+
+private:
+    struct SizeClass {
+        uint8_t* slab;
+        size_t size;
+        uint32_t count;
+        /// @brief Stack of free buffers, \p free entries deep
+        void** freeList;
+        uint32_t free;
+        /// @brief Bytes asked for by each acquired buffer, by index in the slab; SIZE_MAX for a free one
+        size_t* requested;
+    };
+
+    /// @brief Index of the class whose slab holds \p buffer, -1 if none
+    int findClass(const void* buffer) const;
+
+    SizeClass sizeClasses[MAX_CLASSES] = {};
+    uint32_t classCount = 0;
+    mutable portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    BufferPoolStats counters = {};
+};
+
+} // namespace fastcopy
@@ -0,0 +1,76 @@
+/*
+* Double-buffered streaming: processes a large (PSRAM) buffer in internal RAM tiles,
+* with the DMA filling one tile while the CPU works on the other.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+namespace fastcopy {
+
+class BufferPool;
+
+/// @brief Called with each tile in turn, in the calling task
+/// @param tile the tile, in internal RAM. Only valid until the callback returns.
+/// @param size bytes in this tile; all but the last tile are the full tile size
+/// @param offset the tile's offset in the source buffer
+/// @param arg the argument given to StreamPipeline::run()
+typedef void (*TileCallback)(void* tile, size_t size, size_t offset, void* arg);
+
+/// @brief Timing of a StreamPipeline::run(), in CPU cycles
+struct StreamStats {
+    uint32_t tiles;
+    uint64_t bytes;
+    /// @brief run() from start to finish
+    uint64_t totalCycles;
+    /// @brief Time a tile transfer was in flight, summed over all tiles
+    uint64_t transferCycles;
+    /// @brief Time spent in the callback
+    uint64_t processCycles;
+    /// @brief Time the CPU waited for a tile. Transfer time not waited for was hidden behind processing.
+    uint64_t waitCycles;
+};
+
+class StreamPipeline {
+public:
+    StreamPipeline() = default;
+    StreamPipeline(const StreamPipeline&) = delete;
+    StreamPipeline& operator=(const StreamPipeline&) = delete;
+    ~StreamPipeline() { stop(); }
+
+    /// @brief Allocates the two tiles in DMA capable internal RAM. Does nothing if already started.
+    /// @param tileSize bytes per tile, rounded up to the cache line size
+    /// @param pool if given, the tiles are acquired from this pool instead of the heap.
+    /// Its buffers must be DMA capable internal RAM.
+    esp_err_t start(size_t tileSize, BufferPool* pool = nullptr);
+
+    /// @brief Frees the tiles, or returns them to their pool
+    void stop();
+
+    bool started() const { return tiles[0] != nullptr; }
+
+    size_t tileSize() const { return size; }
+
+    /// @brief Streams \p size bytes from \p source through the tiles, calling \p cb for each one.
+    /// The DMA fetches the next tile while \p cb runs on the current one.
+    /// A PSRAM source must be cache line aligned; it is written back from the cache once up front.
+    /// Uses the calling task's DmaService::NOTIFY_INDEX notification for the DMA completions.
+    /// @return ESP_OK if successful. Otherwise an error code from the DMA
+    esp_err_t run(const void* source, size_t size, TileCallback cb, void* arg);
+
+    /// @brief The timing of the last run()
+    const StreamStats& stats() const { return counters; }
+
+private:
+    void* tiles[2] = {};
+    size_t size = 0;
+    BufferPool* tilePool = nullptr;
+    StreamStats counters = {};
+};
+
+} // namespace fastcopy
@@ -0,0 +1,54 @@
+/*
+* Copies which transform the data on the way: byte swaps, pixel format
+* conversion and a constant mask.
+*
+* Doing the transform as part of the copy reads the source once instead of
+* copying it and then reading it all back for a second pass, which is what
+* matters when the source is in PSRAM.
+*
+* Portable, with PIE fast paths on the ESP32-S3 when source and destination
+* share the same offset from a 16-byte boundary. Every function also works in
+* place, with \p dest equal to \p source.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fastcopy.h"
+
+namespace fastcopy {
+
+/// @brief Copies a buffer of 16-bit values, swapping the two bytes of each, e.g. RGB565 for an SPI display.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy. Only whole 16-bit values are copied.
+void copy_swap16(void* dest, const void* source, size_t size);
+
+/// @brief Copies a buffer of 32-bit values, reversing the four bytes of each.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy. Only whole 32-bit values are copied.
+void copy_swap32(void* dest, const void* source, size_t size);
+
+/// @brief Copies a buffer of 32-bit words as <tt>(word & andMask) ^ xorMask</tt>,
+/// e.g. to invert a monochrome framebuffer or to clear the alpha bytes of ARGB pixels.
+/// The masks apply to the words counted from \p dest and \p source as they are.
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy. Only whole 32-bit words are copied.
+/// @param andMask kept bits of every word
+/// @param xorMask bits flipped in every word after masking
+void copy_mask(void* dest, const void* source, size_t size, uint32_t andMask, uint32_t xorMask);
+
+/// @brief Converts RGB888 pixels, stored as R, G, B bytes, to RGB565.
+/// Works on 4 pixels at a time as 3 words in and 2 words out when both buffers are 4-byte aligned.
+/// @param dest pointer to the 2 * \p pixels bytes to write
+/// @param source pointer to the 3 * \p pixels bytes to read
+/// @param pixels number of pixels to convert
+/// @param swap \c true to store each RGB565 value with its bytes swapped, high byte first
+void convert_rgb888_rgb565(void* dest, const void* source, size_t pixels, bool swap = false);
+
+} // namespace fastcopy
@@ -0,0 +1,72 @@
+/*
+* A family of PIE copy kernels generated at compile time: 1 to 8 Q registers per
+* loop iteration, with a choice of load/store order.
+*
+* copy_pie_16() is copy_pie_unrolled<1, PieSchedule::Paired> and copy_pie_32() is
+* copy_pie_unrolled<2, PieSchedule::Grouped>; the rest of the family exists to find
+* out whether anything beats them.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+
+#include "fastcopy/pie.hpp"
+
+namespace fastcopy {
+
+/// @brief Order of the loads and stores within one loop iteration of N registers
+enum class PieSchedule {
+    /// @brief L0 L1 .. Ln S0 S1 .. Sn: all loads, then all stores
+    Grouped,
+    /// @brief L0 S0 L1 S1 ..: each register stored straight after it was loaded
+    Paired,
+    /// @brief L0 L1 S0 L2 S1 .. Sn: each store one load behind its load
+    Staggered,
+};
+
+namespace internal {
+
+    template<PieSchedule S, uint8_t N, uint8_t... R>
+    static IRAM_ATTR inline void INL pie_block(const void*& src_p, void*& dest_p, std::integer_sequence<uint8_t, R...>) {
+        if constexpr (S == PieSchedule::Grouped) {
+            (vld_128_ip<R>(src_p), ...);
+            (vst_128_ip<R>(dest_p), ...);
+        } else if constexpr (S == PieSchedule::Paired) {
+            ((vld_128_ip<R>(src_p), vst_128_ip<R>(dest_p)), ...);
+        } else {
+            vld_128_ip<0>(src_p);
+            ([&]() {
+                if constexpr (R + 1 < N) {
+                    vld_128_ip<(R + 1 < N ? R + 1 : R)>(src_p);
+                }
+                vst_128_ip<R>(dest_p);
+            }(), ...);
+        }
+    }
+
+}
+
+/// @brief Copies a buffer using the ESP32-S3 PIE 128-bit load/store instructions, \p N registers per iteration
+/// @tparam N number of Q registers used, i.e. 16 * N bytes per iteration
+/// @tparam S order of the loads and stores within an iteration
+/// @param dest pointer to the buffer to copy to, 16-byte aligned
+/// @param source pointer to the buffer to copy from, 16-byte aligned
+/// @param size amount of memory to copy. Only whole 16 * N byte blocks are copied.
+template<uint8_t N, PieSchedule S>
+requires ( 1 <= N && N <= 8 )
+static IRAM_ATTR inline void copy_pie_unrolled(void* dest, const void* source, size_t size)
+{
+    const uint32_t cnt = size / (16 * N);
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    rpt(cnt, [&src_p,&dest_p]() {
+        internal::pie_block<S, N>(src_p, dest_p, std::make_integer_sequence<uint8_t, N>{});
+    });
+}
+
+} // namespace fastcopy
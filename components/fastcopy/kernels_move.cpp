@@ -0,0 +1,130 @@
+/*
+* ESP32-S3 PIE 128-bit memmove kernels for overlapping buffers.
+*
+* A forward copy is safe when the destination lies below the source, a backward
+* copy when it lies above: either way every block is loaded before the stores
+* can reach it. The backward kernels run the same loads and stores as the
+* forward ones with a negative increment, starting from the last block.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/pie.hpp"
+
+namespace fastcopy {
+
+/// @brief Copies whole blocks backward, from the block ending at \p dest_end, all 16-byte aligned
+static IRAM_ATTR void move_pie_blocks_backward(uint8_t* dest_end, const uint8_t* src_end, uint32_t blocks)
+{
+    void* dest_p = dest_end - 16;
+    const void* src_p = src_end - 16;
+
+    // The 32 byte loop of copy_pie_32(), walking down.
+    rpt(blocks / 2, [&src_p,&dest_p]() {
+        vld_128_ip<0,-16>(src_p);
+        vld_128_ip<1,-16>(src_p);
+        vst_128_ip<0,-16>(dest_p);
+        vst_128_ip<1,-16>(dest_p);
+    });
+    if(blocks & 1) {
+        vld_128_ip<0,-16>(src_p);
+        vst_128_ip<0,-16>(dest_p);
+    }
+}
+
+/// @brief Copies whole blocks backward to the block ending at \p dest_end (16-byte aligned) from a misaligned source
+static IRAM_ATTR void move_pie_blocks_backward_unaligned(uint8_t* dest_end, const uint8_t* src_end, uint32_t blocks)
+{
+    void* dest_p = dest_end - 16;
+    const uint8_t* src_p = src_end;
+
+    /* The mirror image of the misaligned loop in copy_pie_unaligned(): the aligned
+       block holding the top source bytes is loaded first, and each following load
+       fetches the block below it, which EE.SRC.Q needs as the low half.
+       SAR_BYTE is the same for every load because src_p only moves in steps of 16.
+    */
+    ld_128_usar_ip<0,-16>(src_p); // q0 = aligned block holding the last source bytes
+
+    rpt(blocks / 2, [&src_p,&dest_p]() {
+        ld_128_usar_ip<1,-16>(src_p); // q1 = the aligned block below
+        src_q<2,1,0>();                // q2 = 16 bytes straddling q1:q0
+        ld_128_usar_ip<0,-16>(src_p); // q0 = the aligned block below that
+        vst_128_ip<2,-16>(dest_p);
+        src_q<3,0,1>();                // q3 = 16 bytes straddling q0:q1
+        vst_128_ip<3,-16>(dest_p);
+    });
+
+    if(blocks & 1) {
+        ld_128_usar_ip<1,-16>(src_p);
+        src_q<2,1,0>();
+        vst_128_ip<2,-16>(dest_p);
+    }
+}
+
+IRAM_ATTR void move_pie_backward(void* dest, const void* source, size_t size)
+{
+    uint8_t* dest_end = (uint8_t*)dest + size;
+    const uint8_t* src_end = (const uint8_t*)source + size;
+
+    // Tail first: bring the end of dest down to a 16-byte boundary.
+    size_t tail = (uintptr_t)dest_end & 0xf;
+    if(tail > size) {
+        tail = size;
+    }
+    dest_end -= tail;
+    src_end -= tail;
+    memmove(dest_end, src_end, tail);
+    size -= tail;
+
+    const uint32_t blocks = size / 16;
+    const size_t head = size & 0xf;
+
+    if(((uintptr_t)src_end & 0xf) == 0) {
+        move_pie_blocks_backward(dest_end, src_end, blocks);
+    } else if(blocks != 0) {
+        move_pie_blocks_backward_unaligned(dest_end, src_end, blocks);
+    }
+
+    // Head last: whatever is left below the first whole block.
+    memmove(dest, source, head);
+}
+
+IRAM_ATTR void move_pie_forward(void* dest, const void* source, size_t size)
+{
+    uint8_t* dest_p = (uint8_t*)dest;
+    const uint8_t* src_p = (const uint8_t*)source;
+
+    // Head first: bring dest up to a 16-byte boundary.
+    size_t head = (16 - ((uintptr_t)dest_p & 0xf)) & 0xf;
+    if(head > size) {
+        head = size;
+    }
+    memmove(dest_p, src_p, head);
+    dest_p += head;
+    src_p += head;
+    size -= head;
+
+    // With dest aligned and whole blocks only, copy_pie_unaligned() is all loads ahead of
+    // the stores, which is safe while the destination lies below the source.
+    const size_t body = size & ~(size_t)0xf;
+    copy_pie_unaligned(dest_p, src_p, body);
+
+    // Tail last.
+    memmove(dest_p + body, src_p + body, size - body);
+}
+
+IRAM_ATTR void move_pie(void* dest, const void* source, size_t size)
+{
+    if((uintptr_t)dest - (uintptr_t)source >= size) {
+        // dest is below source, or past its end: copying forward never overwrites unread source bytes.
+        move_pie_forward(dest, source, size);
+    } else {
+        move_pie_backward(dest, source, size);
+    }
+}
+
+} // namespace fastcopy
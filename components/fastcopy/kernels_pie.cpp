@@ -0,0 +1,158 @@
+/*
+* ESP32-S3 PIE 128-bit copy kernels.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/pie.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dispatch.hpp"
+
+namespace fastcopy {
+
+IRAM_ATTR void copy_pie_16(void* dest, const void* source, size_t size)
+{
+    // Setup the variables
+    const uint32_t bytes_per_iteration = 16;
+    const uint32_t cnt = size / bytes_per_iteration;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    // Due to the extra latency of the load instruction, this code copies 16 bytes in (2+1) CPU clock cycles.
+    rpt(cnt, [&src_p,&dest_p]() {
+        vld_128_ip<0>(src_p); // Load 16 bytes from RAM into q0, increment src_p
+        vst_128_ip<0>(dest_p); // Store 16 bytes from q0 to RAM, increment dest_p
+    });
+}
+
+IRAM_ATTR void copy_pie_32(void* dest, const void* source, size_t size)
+{
+    // Setup the variables
+    const uint32_t bytes_per_iteration = 32;
+    const uint32_t cnt = size / bytes_per_iteration;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    /* Alternating access between two Q registers allows the pipeline to hide the latency
+       incurred from the data dependency of successive instructions.
+       Interestingly, the still-present data dependency on the _address_ register does
+       _not_ induce any pipeline stalls.
+
+       Thanks to the CPU pipeline, this code copies 32 bytes in 4 CPU clock cycles.
+    */
+    rpt(cnt, [&src_p,&dest_p]() {
+        vld_128_ip<0>(src_p); // Load 16 bytes from RAM into q0, increment src_p
+        vld_128_ip<1>(src_p); // Load 16 bytes from RAM into q1, increment src_p
+        vst_128_ip<0>(dest_p); // Store 16 bytes from q0 to RAM, increment dest_p
+        vst_128_ip<1>(dest_p); // Store 16 bytes from q1 to RAM, increment dest_p
+    });
+}
+
+IRAM_ATTR void copy_pie_unaligned(void* dest, const void* source, size_t size)
+{
+    uint8_t* dest_p = (uint8_t*)dest;
+    const uint8_t* src_p = (const uint8_t*)source;
+
+    // Head: bring dest up to a 16-byte boundary, the PIE stores can't do unaligned.
+    const Split sp = split<16>((uintptr_t)dest_p, size);
+    memcpy(dest_p, src_p, sp.head);
+    dest_p += sp.head;
+    src_p += sp.head;
+
+    const uint32_t blocks = sp.body / 16;
+    const size_t tail = sp.tail;
+    uint8_t* const dest_tail = dest_p + blocks * 16;
+    const uint8_t* const src_tail = src_p + blocks * 16;
+
+    if(((uintptr_t)src_p & 0xf) == 0) {
+        // Source and dest ended up equally aligned, no realignment needed.
+        copy_pie_32(dest_p, src_p, blocks * 16);
+        if(blocks & 1) {
+            copy_pie_16(dest_p + (blocks - 1) * 16, src_p + (blocks - 1) * 16, 16);
+        }
+    } else if(blocks != 0) {
+        /* Each aligned load also sets SAR_BYTE to the source misalignment, and
+           EE.SRC.Q then extracts the 16 source bytes straddling two aligned blocks.
+           q0 and q1 swap roles every 16 bytes, so there is no register move, and the
+           next load is issued before the store so its latency is hidden.
+           Only the aligned blocks that contain source bytes are read.
+        */
+        ld_128_usar_ip<0>(src_p); // q0 = first aligned block, SAR_BYTE = misalignment
+
+        rpt(blocks / 2, [&src_p,&dest_p]() {
+            ld_128_usar_ip<1>(src_p); // q1 = next aligned block
+            src_q<2,0,1>();            // q2 = 16 bytes straddling q0:q1
+            ld_128_usar_ip<0>(src_p); // q0 = next aligned block
+            vst_128_ip<2>(dest_p);
+            src_q<3,1,0>();            // q3 = 16 bytes straddling q1:q0
+            vst_128_ip<3>(dest_p);
+        });
+
+        if(blocks & 1) {
+            ld_128_usar_ip<1>(src_p);
+            src_q<2,0,1>();
+            vst_128_ip<2>(dest_p);
+        }
+    }
+
+    // Tail: whatever is left after the last whole block.
+    memcpy(dest_tail, src_tail, tail);
+}
+
+IRAM_ATTR void fill_pie_32(void* dest, uint32_t pattern, size_t size)
+{
+    uint32_t* dest_w = (uint32_t*)dest;
+    size_t words = size / sizeof(uint32_t);
+
+    // Head: single words up to the first 16-byte boundary.
+    while(words != 0 && ((uintptr_t)dest_w & 0xf) != 0) {
+        *dest_w++ = pattern;
+        words--;
+    }
+
+    const uint32_t blocks = words / 4;
+    void* dest_p = dest_w;
+
+    vldbc_32<0>(&pattern); // q0 = pattern in all four words
+
+    // Two stores of the same register per iteration, 32 bytes in 2 CPU clock cycles.
+    rpt(blocks / 2, [&dest_p]() {
+        vst_128_ip<0>(dest_p);
+        vst_128_ip<0>(dest_p);
+    });
+    if(blocks & 1) {
+        vst_128_ip<0>(dest_p);
+    }
+
+    // Tail: the words left after the last whole block.
+    dest_w = (uint32_t*)dest_p;
+    for(words &= 3; words != 0; words--) {
+        *dest_w++ = pattern;
+    }
+}
+
+IRAM_ATTR void fill_pie(void* dest, uint8_t value, size_t size)
+{
+    const Split sp = split<16, 4>((uintptr_t)dest, size);
+    memset(dest, value, sp.head);
+
+    uint8_t* body = (uint8_t*)dest + sp.head;
+    fill_pie_32(body, value * 0x01010101u, sp.body);
+
+    memset(body + sp.body, value, sp.tail);
+}
+
+IRAM_ATTR void copy_cpu(void* dest, const void* source, size_t size)
+{
+    if(!isExtMem(dest) && !isExtMem(source)) {
+        copy_pie_unaligned(dest, source, size);
+    } else {
+        memcpy(dest, source, size);
+    }
+}
+
+} // namespace fastcopy
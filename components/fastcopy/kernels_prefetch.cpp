@@ -0,0 +1,64 @@
+/*
+* PIE copy with a data cache preload running ahead of it.
+*
+* The copy advances in steps of half the preload distance. Before each step the
+* preload is topped up to \p distance bytes past the copy, as soon as the
+* previous preload has finished, so the cache fetches PSRAM lines while the
+* CPU copies lines that have already arrived.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/cache.hpp"
+
+namespace fastcopy {
+
+IRAM_ATTR void copy_prefetch(void* dest, const void* source, size_t size, size_t distance)
+{
+    const uintptr_t ls = internal::getCacheLineSize();
+    const size_t step = (distance / 2) & ~(ls-1);
+    if(step == 0 || !isExtMem(source)) {
+        copy_pie_unaligned(dest, source, size);
+        return;
+    }
+
+    uint8_t* dest_p = (uint8_t*)dest;
+    const uint8_t* src_p = (const uint8_t*)source;
+
+    // Preloads cover whole lines, from the source's first line to its last.
+    const uintptr_t end = ((uintptr_t)src_p + size + (ls-1)) & ~(ls-1);
+    uintptr_t requested = (uintptr_t)src_p & ~(ls-1);
+    uint32_t autoload = 0;
+    bool active = false;
+
+    for(size_t offset = 0; offset < size; offset += step) {
+        if(active && internal::preloadDone()) {
+            internal::preloadEnd(autoload);
+            active = false;
+        }
+
+        uintptr_t target = ((uintptr_t)src_p + offset + distance + (ls-1)) & ~(ls-1);
+        if(target > end) {
+            target = end;
+        }
+        if(!active && requested < target) {
+            autoload = internal::preloadStart((const void*)requested, target - requested);
+            requested = target;
+            active = true;
+        }
+
+        const size_t len = (size - offset) < step ? (size - offset) : step;
+        copy_pie_unaligned(dest_p + offset, src_p + offset, len);
+    }
+
+    if(active) {
+        while(!internal::preloadDone()) {
+        }
+        internal::preloadEnd(autoload);
+    }
+}
+
+} // namespace fastcopy
@@ -0,0 +1,149 @@
+/*
+* Dual-core copy: one transfer split across worker tasks pinned to each core.
+*
+* The caller fills in each worker's slice, gives each worker a notification and
+* then takes a private counting semaphore once per worker. The workers' own
+* notifications are theirs alone, but the caller's belong to whatever task it
+* is, which may be waiting on them for something else, so the finished slices
+* are counted on the semaphore instead.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+
+#include "fastcopy/parallel.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/cache.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+esp_err_t ParallelCopy::start(UBaseType_t priority, uint32_t stackSize)
+{
+    if(started()) {
+        return ESP_OK;
+    }
+
+    done = xSemaphoreCreateCounting(portNUM_PROCESSORS, 0);
+    if(!done) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    quit = false;
+    for(uint32_t core = 0; core < portNUM_PROCESSORS; core++) {
+        Worker& w = workers[core];
+        w = {};
+        w.owner = this;
+        if(xTaskCreatePinnedToCore(&run, "fastcopy", stackSize, &w, priority, &w.task, core) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create the copy worker on core %u", (unsigned)core);
+            w.task = nullptr;
+            stop();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void ParallelCopy::stop()
+{
+    uint32_t running = 0;
+    while(running < portNUM_PROCESSORS && workers[running].task) {
+        running++;
+    }
+    if(running != 0) {
+        // Each worker acknowledges the quit before deleting itself.
+        quit = true;
+        wake(running);
+        for(uint32_t core = 0; core < portNUM_PROCESSORS; core++) {
+            workers[core].task = nullptr;
+        }
+    }
+    if(done) {
+        vSemaphoreDelete(done);
+        done = nullptr;
+    }
+}
+
+void ParallelCopy::wake(uint32_t count)
+{
+    for(uint32_t core = 0; core < count; core++) {
+        xTaskNotifyGive(workers[core].task);
+    }
+    for(uint32_t core = 0; core < count; core++) {
+        xSemaphoreTake(done, portMAX_DELAY);
+    }
+}
+
+IRAM_ATTR void ParallelCopy::copy(void* dest, const void* source, size_t size, uint32_t cores,
+                                  CopyFunction kernel, bool writeBack)
+{
+    if(cores < 1) {
+        cores = 1;
+    } else if(cores > portNUM_PROCESSORS) {
+        cores = portNUM_PROCESSORS;
+    }
+
+    this->kernel = kernel ? kernel : &copy_cpu;
+    this->writeBack = writeBack && isExtMem(dest);
+
+    // Slice boundaries are rounded up to a cache line of the destination. Only the
+    // first and last slices can start or end part way through a line.
+    const uintptr_t ls = internal::getCacheLineSize();
+    size_t begin = 0;
+    for(uint32_t core = 0; core < cores; core++) {
+        size_t end = size;
+        if(core + 1 < cores) {
+            const uintptr_t split = ((uintptr_t)dest + (uint64_t)size * (core + 1) / cores + (ls-1)) & ~(ls-1);
+            end = split - (uintptr_t)dest;
+            if(end < begin) {
+                end = begin;
+            } else if(end > size) {
+                end = size;
+            }
+        }
+        Worker& w = workers[core];
+        w.dest = (uint8_t*)dest + begin;
+        w.source = (const uint8_t*)source + begin;
+        w.size = end - begin;
+        begin = end;
+    }
+
+    wake(cores);
+}
+
+IRAM_ATTR void ParallelCopy::run(void* arg)
+{
+    Worker& w = *(Worker*)arg;
+    ParallelCopy& owner = *w.owner;
+
+    for(;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if(owner.quit) {
+            break;
+        }
+
+        const uint32_t tstart = esp_cpu_get_cycle_count();
+        if(w.size != 0) {
+            owner.kernel(w.dest, w.source, w.size);
+            if(owner.writeBack) {
+                // The cache is shared by both cores, so each worker writes back just its own slice.
+                compiler_mem_barrier(w.dest, w.size);
+                esp_cache_msync(w.dest, w.size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+            }
+        }
+        // Cycle counters aren't synchronised between the cores, so only a duration is kept.
+        w.cycles = esp_cpu_get_cycle_count() - tstart;
+
+        xSemaphoreGive(owner.done);
+    }
+
+    xSemaphoreGive(owner.done);
+    vTaskDelete(nullptr);
+}
+
+} // namespace fastcopy
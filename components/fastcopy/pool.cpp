@@ -0,0 +1,209 @@
+/*
+* BufferPool: size classes doubling from the smallest, over one slab each.
+*
+* The smallest class a request fits is found from the size alone, and a buffer's
+* class from its address, so neither acquire() nor release() searches more than
+* the handful of classes. The free lists and bookkeeping live in internal RAM,
+* so a PSRAM pool's buffers are never written by the pool itself.
+*
+* A slot's entry in requested[] is FREE_SLOT while it is on the free list. That
+* is what lets release() turn away a buffer released twice, which would
+* otherwise be pushed past the end of the free list and handed out twice.
+*
+*/
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "fastcopy/pool.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dispatch.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+/// @brief requested[] entry of a slot on the free list. No request that large can be served.
+static const size_t FREE_SLOT = SIZE_MAX;
+
+esp_err_t BufferPool::start(const BufferPoolConfig& config)
+{
+    if(started()) {
+        return ESP_OK;
+    }
+    if(config.classes == 0 || config.classes > MAX_CLASSES || config.buffers == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const size_t ls = internal::getCacheLineSize();
+    size_t size = config.minSize < ls ? ls : (config.minSize + (ls-1)) & ~(ls-1);
+
+    counters = {};
+    for(uint32_t c = 0; c < config.classes; c++, size *= 2) {
+        SizeClass& sc = sizeClasses[c];
+        sc.size = size;
+        sc.count = config.buffers;
+        sc.slab = (uint8_t*)heap_caps_aligned_alloc(ls, size * config.buffers, config.caps);
+        sc.freeList = (void**)heap_caps_calloc(config.buffers, sizeof(void*), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        sc.requested = (size_t*)heap_caps_calloc(config.buffers, sizeof(size_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        classCount = c + 1;
+        if(!sc.slab || !sc.freeList || !sc.requested) {
+            ESP_LOGE(TAG, "Failed to allocate %" PRIu32 " pool buffers of %u bytes", config.buffers, (unsigned)size);
+            stop();
+            return ESP_ERR_NO_MEM;
+        }
+
+        // Pushed in reverse so the first acquire() gets the start of the slab.
+        for(uint32_t i = 0; i < sc.count; i++) {
+            sc.freeList[i] = sc.slab + (sc.count - 1 - i) * size;
+            sc.requested[i] = FREE_SLOT;
+        }
+        sc.free = sc.count;
+        counters.reserved += size * sc.count;
+    }
+    return ESP_OK;
+}
+
+void BufferPool::stop()
+{
+    for(uint32_t c = 0; c < classCount; c++) {
+        SizeClass& sc = sizeClasses[c];
+        free(sc.slab);
+        free(sc.freeList);
+        free(sc.requested);
+        sc = {};
+    }
+    classCount = 0;
+}
+
+IRAM_ATTR void* BufferPool::acquire(size_t size)
+{
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    // Nothing to hand out, and no class for it. SIZE_MAX would also read as FREE_SLOT.
+    if(size == 0 || size > maxSize()) {
+        portENTER_CRITICAL(&lock);
+        counters.failed++;
+        portEXIT_CRITICAL(&lock);
+        return nullptr;
+    }
+    const uint32_t first = size_class(size, sizeClasses[0].size);
+
+    void* buffer = nullptr;
+    portENTER_CRITICAL(&lock);
+    for(uint32_t c = first; c < classCount; c++) {
+        SizeClass& sc = sizeClasses[c];
+        if(sc.free == 0) {
+            continue;
+        }
+        buffer = sc.freeList[--sc.free];
+        sc.requested[((uint8_t*)buffer - sc.slab) / sc.size] = size;
+
+        counters.acquired++;
+        counters.spilled += c != first;
+        counters.inUse++;
+        counters.requestedBytes += size;
+        counters.usedBytes += sc.size;
+        if(counters.inUse > counters.peakInUse) {
+            counters.peakInUse = counters.inUse;
+        }
+        if(counters.usedBytes > counters.peakUsedBytes) {
+            counters.peakUsedBytes = counters.usedBytes;
+        }
+        break;
+    }
+    if(!buffer) {
+        counters.failed++;
+    }
+    const uint32_t cycles = esp_cpu_get_cycle_count() - tstart;
+    counters.acquireCycles += cycles;
+    if(cycles > counters.maxAcquireCycles) {
+        counters.maxAcquireCycles = cycles;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return buffer;
+}
+
+IRAM_ATTR int BufferPool::findClass(const void* buffer) const
+{
+    const uint8_t* p = (const uint8_t*)buffer;
+    for(uint32_t c = 0; c < classCount; c++) {
+        const SizeClass& sc = sizeClasses[c];
+        if(p >= sc.slab && p < sc.slab + sc.size * sc.count) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+IRAM_ATTR bool BufferPool::release(void* buffer)
+{
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    const int c = findClass(buffer);
+    if(c < 0) {
+        return false;
+    }
+    SizeClass* sc = &sizeClasses[c];
+    const size_t offset = (uint8_t*)buffer - sc->slab;
+    const size_t slot = offset / sc->size;
+
+    portENTER_CRITICAL(&lock);
+    // Not the start of a slot, or a slot that is already free: released twice, or never acquired.
+    if(offset % sc->size != 0 || sc->requested[slot] == FREE_SLOT) {
+        counters.rejected++;
+        portEXIT_CRITICAL(&lock);
+        return false;
+    }
+    assert(sc->free < sc->count);
+    sc->freeList[sc->free++] = buffer;
+
+    counters.released++;
+    counters.inUse--;
+    counters.requestedBytes -= sc->requested[slot];
+    counters.usedBytes -= sc->size;
+    sc->requested[slot] = FREE_SLOT;
+    const uint32_t cycles = esp_cpu_get_cycle_count() - tstart;
+    counters.releaseCycles += cycles;
+    if(cycles > counters.maxReleaseCycles) {
+        counters.maxReleaseCycles = cycles;
+    }
+    portEXIT_CRITICAL(&lock);
+
+    return true;
+}
+
+bool BufferPool::owns(const void* buffer) const
+{
+    return findClass(buffer) >= 0;
+}
+
+BufferPoolStats BufferPool::stats() const
+{
+    portENTER_CRITICAL(&lock);
+    const BufferPoolStats s = counters;
+    portEXIT_CRITICAL(&lock);
+    return s;
+}
+
+void BufferPool::resetStats()
+{
+    portENTER_CRITICAL(&lock);
+    const BufferPoolStats s = counters;
+    counters = {};
+    counters.reserved = s.reserved;
+    counters.inUse = counters.peakInUse = s.inUse;
+    counters.requestedBytes = s.requestedBytes;
+    counters.usedBytes = counters.peakUsedBytes = s.usedBytes;
+    portEXIT_CRITICAL(&lock);
+}
+
+} // namespace fastcopy
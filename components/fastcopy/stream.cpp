@@ -0,0 +1,146 @@
+/*
+* Double-buffered streaming through internal RAM tiles.
+*
+* Each tile is fetched with DmaService::submit() notifying the calling task, so the
+* notification value gives the exact completion time of every transfer. Only the
+* cache line aligned part of a tile goes through the DMA; the few bytes left over at
+* the very end of the source are copied by the CPU.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/stream.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+#include "fastcopy/pool.hpp"
+
+static const char *TAG = "fastcopy";
+
+namespace fastcopy {
+
+esp_err_t StreamPipeline::start(size_t tileSize, BufferPool* pool)
+{
+    if(started()) {
+        return ESP_OK;
+    }
+
+    const size_t ls = internal::getCacheLineSize();
+    size = (tileSize + (ls-1)) & ~(ls-1);
+    tilePool = pool;
+    for(void*& tile : tiles) {
+        tile = pool ? pool->acquire(size) : heap_caps_aligned_alloc(ls, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+        if(!tile) {
+            ESP_LOGE(TAG, "Failed to allocate the stream tiles");
+            stop();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+void StreamPipeline::stop()
+{
+    for(void*& tile : tiles) {
+        if(tilePool && tile) {
+            tilePool->release(tile);
+        } else {
+            free(tile);
+        }
+        tile = nullptr;
+    }
+    tilePool = nullptr;
+    size = 0;
+}
+
+IRAM_ATTR esp_err_t StreamPipeline::run(const void* source, size_t length, TileCallback cb, void* arg)
+{
+    if(!started()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    DmaService* service;
+    const esp_err_t serviceStarted = dmaService(&service);
+    if(serviceStarted != ESP_OK) {
+        return serviceStarted;
+    }
+    const size_t ls = internal::getCacheLineSize();
+    const bool extSrc = isExtMem(source);
+    if(extSrc && ((uintptr_t)source & (ls-1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    counters = {};
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    if(extSrc) {
+        // Whole lines only; the part of the last line past the end is written back too, which is harmless.
+        esp_cache_msync((void*)source, (length + (ls-1)) & ~(ls-1), ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+    }
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    const uint8_t* src = (const uint8_t*)source;
+    const uint32_t count = (length + size - 1) / size;
+
+    // Fetches tile i into tiles[i & 1]
+    uint32_t tsubmit = 0;
+    bool inFlight = false;
+    auto fetch = [&](uint32_t i) -> esp_err_t {
+        const size_t offset = (size_t)i * size;
+        const size_t len = (length - offset) < size ? (length - offset) : size;
+        const size_t dmaLen = len & ~(ls-1);
+        inFlight = false;
+        if(dmaLen == 0) {
+            return ESP_OK;
+        }
+        tsubmit = esp_cpu_get_cycle_count();
+        const esp_err_t r = service->submit(tiles[i & 1], src + offset, dmaLen, task);
+        inFlight = (r == ESP_OK);
+        return r;
+    };
+
+    esp_err_t r = count ? fetch(0) : ESP_OK;
+
+    for(uint32_t i = 0; i < count && r == ESP_OK; i++) {
+        const size_t offset = (size_t)i * size;
+        const size_t len = (length - offset) < size ? (length - offset) : size;
+        const size_t dmaLen = len & ~(ls-1);
+        void* tile = tiles[i & 1];
+
+        const uint32_t twait = esp_cpu_get_cycle_count();
+        if(inFlight) {
+            const uint32_t tdone = DmaService::waitNotified();
+            counters.transferCycles += tdone - tsubmit;
+        }
+        if(dmaLen != len) {
+            memcpy((uint8_t*)tile + dmaLen, src + offset + dmaLen, len - dmaLen);
+        }
+        counters.waitCycles += esp_cpu_get_cycle_count() - twait;
+
+        // Start on the next tile before processing this one; that's the overlap.
+        if(i + 1 < count) {
+            r = fetch(i + 1);
+        }
+
+        const uint32_t tprocess = esp_cpu_get_cycle_count();
+        cb(tile, len, offset, arg);
+        counters.processCycles += esp_cpu_get_cycle_count() - tprocess;
+
+        counters.tiles++;
+        counters.bytes += len;
+    }
+
+    counters.totalCycles = esp_cpu_get_cycle_count() - tstart;
+    return r;
+}
+
+} // namespace fastcopy
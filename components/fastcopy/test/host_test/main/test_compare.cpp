@@ -0,0 +1,48 @@
+/*
+* equal(), checksum() and crc32() from fastcopy/compare.hpp.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "fastcopy/compare.hpp"
+
+using namespace fastcopy;
+
+TEST_CASE("crc32 matches the standard CRC-32 and can be continued", "[fastcopy][compare]")
+{
+    static const char check[] = "123456789";
+    const size_t length = strlen(check);
+
+    TEST_ASSERT_EQUAL_HEX32(0x00000000, crc32(check, 0));
+    TEST_ASSERT_EQUAL_HEX32(0xcbf43926, crc32(check, length));
+
+    for (size_t split = 0; split <= length; split++)
+        TEST_ASSERT_EQUAL_HEX32(0xcbf43926, crc32(check + split, length - split, crc32(check, split)));
+}
+
+TEST_CASE("equal and changed spot a single flipped bit", "[fastcopy][compare]")
+{
+    alignas(16) static uint8_t a[1024 + 16];
+    alignas(16) static uint8_t b[1024 + 16];
+    for (size_t i = 0; i < sizeof(a); i++)
+        a[i] = b[i] = (uint8_t)(i * 31);
+
+    uint64_t sum = 0;
+    TEST_ASSERT_TRUE(changed(a, sizeof(a), sum));
+    TEST_ASSERT_FALSE(changed(a, sizeof(a), sum));
+
+    for (size_t i = 0; i < sizeof(a); i += 97) {
+        b[i] ^= 0x10;
+        TEST_ASSERT_FALSE(equal(a, b, sizeof(a)));
+        TEST_ASSERT_TRUE(equal(a + i + 1, b + i + 1, sizeof(a) - i - 1));
+        TEST_ASSERT_TRUE(changed(b, sizeof(b), sum));
+        b[i] ^= 0x10;
+        TEST_ASSERT_TRUE(equal(a, b, sizeof(a)));
+        TEST_ASSERT_TRUE(changed(b, sizeof(b), sum));
+    }
+}
@@ -0,0 +1,190 @@
+/*
+* The coroutine copies of fastcopy/coro.hpp, scheduled by a HostExecutor over a
+* HostDma. Nothing runs until poll() and nothing is copied until complete(), so
+* each test steps through exactly the order in which coroutines start, suspend
+* on their copy and resume.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+
+#include "unity.h"
+
+#include "fastcopy/coro.hpp"
+#include "fastcopy/coro_host.hpp"
+
+using namespace fastcopy;
+
+/// @brief Bytes per copy
+static const size_t SIZE = 64;
+
+/// @brief Buffers and a trace of what the coroutines did, shared by a test's tasks
+struct Trace {
+    uint8_t source[4][SIZE];
+    uint8_t dest[4][SIZE];
+    /// @brief Task id on starting, id + 10 on resuming after its copy, id + 20 on returning
+    std::vector<int> events;
+    esp_err_t results[4];
+
+    Trace() {
+        for (size_t t = 0; t < 4; t++) {
+            memset(source[t], 0x10 + t, SIZE);
+            memset(dest[t], 0, SIZE);
+            results[t] = ESP_FAIL;
+        }
+    }
+};
+
+/// @brief Copies source[id] to dest[id], recording each step in \p trace
+template<typename Engine>
+static Task Copy_Task(Executor& executor, Engine& engine, Trace& trace, int id)
+{
+    trace.events.push_back(id);
+    const esp_err_t r = co_await copyAsync(executor, engine, trace.dest[id], trace.source[id], SIZE);
+    trace.events.push_back(id + 10);
+    trace.results[id] = r;
+    trace.events.push_back(id + 20);
+    co_return r;
+}
+
+/// @brief Awaits two Copy_Tasks in sequence, returning the first error
+static Task Nested_Task(Executor& executor, HostDma& dma, Trace& trace)
+{
+    esp_err_t r = co_await Copy_Task(executor, dma, trace, 0);
+    if (r == ESP_OK)
+        r = co_await Copy_Task(executor, dma, trace, 1);
+    co_return r;
+}
+
+/// @brief A HostDma which counts finish() calls, which CopyAwaitable makes after a successful copy
+struct FinishingDma : HostDma {
+    using HostDma::HostDma;
+    void finish(void*, size_t size) { finished += size; }
+    size_t finished = 0;
+};
+
+static void Assert_Events(const std::vector<int>& expected, const std::vector<int>& actual)
+{
+    TEST_ASSERT_EQUAL(expected.size(), actual.size());
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected.data(), actual.data(), expected.size());
+}
+
+TEST_CASE("spawned tasks start on poll and resume in completion order", "[fastcopy][coro]")
+{
+    HostExecutor executor;
+    HostDma dma;
+    Trace trace;
+
+    for (int id = 0; id < 3; id++)
+        TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, id)));
+
+    // Spawning only posts: nothing has run or been submitted yet.
+    TEST_ASSERT_EQUAL(3, executor.pending());
+    TEST_ASSERT_TRUE(trace.events.empty());
+    TEST_ASSERT_EQUAL(0, dma.submitted());
+
+    // Each starts in the order it was spawned and suspends on its copy.
+    TEST_ASSERT_EQUAL(3, executor.poll());
+    Assert_Events({ 0, 1, 2 }, trace.events);
+    TEST_ASSERT_EQUAL(3, dma.inFlight());
+    TEST_ASSERT_EQUAL(0, executor.poll());
+
+    // A completion only posts the coroutine; it runs on the next poll.
+    TEST_ASSERT_EQUAL(1, dma.complete(1));
+    Assert_Events({ 0, 1, 2 }, trace.events);
+    TEST_ASSERT_EQUAL(1, executor.poll());
+    Assert_Events({ 0, 1, 2, 10, 20 }, trace.events);
+    TEST_ASSERT_EQUAL(2, executor.pending());
+
+    TEST_ASSERT_EQUAL(2, dma.complete());
+    TEST_ASSERT_EQUAL(2, executor.poll());
+    Assert_Events({ 0, 1, 2, 10, 20, 11, 21, 12, 22 }, trace.events);
+    TEST_ASSERT_EQUAL(0, executor.pending());
+
+    for (int id = 0; id < 3; id++) {
+        TEST_ASSERT_EQUAL(ESP_OK, trace.results[id]);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(trace.source[id], trace.dest[id], SIZE);
+    }
+}
+
+TEST_CASE("a co_awaited task resumes its caller when it returns", "[fastcopy][coro]")
+{
+    HostExecutor executor;
+    HostDma dma;
+    Trace trace;
+
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Nested_Task(executor, dma, trace)));
+    executor.poll();
+    Assert_Events({ 0 }, trace.events);
+
+    // The first copy's completion runs straight on into the second one.
+    dma.complete();
+    executor.poll();
+    Assert_Events({ 0, 10, 20, 1 }, trace.events);
+    TEST_ASSERT_EQUAL(1, executor.pending());
+
+    dma.complete();
+    executor.poll();
+    Assert_Events({ 0, 10, 20, 1, 11, 21 }, trace.events);
+    TEST_ASSERT_EQUAL(0, executor.pending());
+    TEST_ASSERT_EQUAL(2, dma.submitted());
+}
+
+TEST_CASE("a failed submit resumes the task at once with the error", "[fastcopy][coro]")
+{
+    HostExecutor executor;
+    FinishingDma dma(1);
+    Trace trace;
+
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, 0)));
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, 1)));
+
+    // The second copy finds the engine full and carries on without suspending.
+    TEST_ASSERT_EQUAL(2, executor.poll());
+    Assert_Events({ 0, 1, 11, 21 }, trace.events);
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, trace.results[1]);
+    TEST_ASSERT_EQUAL(1, dma.submitted());
+    TEST_ASSERT_EQUAL(1, executor.pending());
+    TEST_ASSERT_EQUAL(0, dma.finished);
+
+    dma.complete();
+    executor.poll();
+    Assert_Events({ 0, 1, 11, 21, 10, 20 }, trace.events);
+    TEST_ASSERT_EQUAL(ESP_OK, trace.results[0]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(trace.source[0], trace.dest[0], SIZE);
+
+    // finish() only ran for the copy that was done.
+    TEST_ASSERT_EQUAL(SIZE, dma.finished);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0, trace.dest[1], SIZE);
+}
+
+TEST_CASE("spawn fails once maxTasks are running", "[fastcopy][coro]")
+{
+    HostExecutor executor(2);
+    HostDma dma;
+    Trace trace;
+
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, 0)));
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, 1)));
+
+    // Turned away before starting; the Task frees the coroutine itself.
+    TEST_ASSERT_EQUAL(ESP_ERR_NO_MEM, executor.spawn(Copy_Task(executor, dma, trace, 2)));
+    TEST_ASSERT_EQUAL(2, executor.pending());
+    executor.poll();
+    Assert_Events({ 0, 1 }, trace.events);
+
+    // Room again once one has finished.
+    dma.complete(1);
+    executor.poll();
+    TEST_ASSERT_EQUAL(1, executor.pending());
+    TEST_ASSERT_EQUAL(ESP_OK, executor.spawn(Copy_Task(executor, dma, trace, 2)));
+    executor.poll();
+
+    dma.complete();
+    executor.poll();
+    Assert_Events({ 0, 1, 10, 20, 2, 11, 21, 12, 22 }, trace.events);
+    TEST_ASSERT_EQUAL(0, executor.pending());
+}
@@ -0,0 +1,171 @@
+/*
+* The decisions of fastcopy/dispatch.hpp: the head/body/tail split the PIE
+* kernels share, which kernel fast_memcpy(), fast_memmove() and fast_memset()
+* run, and the BufferPool size classes.
+*
+* The kernels themselves, PIE and DMA, only exist on the target; here the
+* fast_* functions are memcpy, memmove and memset, so only the choices are
+* tested.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "unity.h"
+
+#include "fastcopy/dispatch.hpp"
+
+using namespace fastcopy;
+
+static const size_t PIE_MIN = CONFIG_FASTCOPY_PIE_MIN_SIZE;
+static const size_t DMA_MIN = CONFIG_FASTCOPY_DMA_MIN_SIZE;
+
+/// @brief Checks \p sp is a split of \p size bytes at \p address for Align and Block
+template<size_t Align, size_t Block>
+static void Check_Split(uintptr_t address, size_t size, const Split& sp)
+{
+    TEST_ASSERT_EQUAL(size, sp.head + sp.body + sp.tail);
+    TEST_ASSERT_TRUE(sp.head < Align);
+    TEST_ASSERT_EQUAL(0, sp.body % Block);
+    TEST_ASSERT_TRUE(sp.tail < Block);
+    if (sp.head < size) {
+        // The buffer reaches the boundary, so the head ends exactly there.
+        TEST_ASSERT_EQUAL(0, (address + sp.head) % Align);
+    } else {
+        // It ends first; nothing is left for the body or tail.
+        TEST_ASSERT_TRUE(address + size <= (address | (Align - 1)) + 1);
+    }
+}
+
+TEST_CASE("split cuts at the alignment boundary and into whole blocks", "[fastcopy][dispatch]")
+{
+    for (uintptr_t address = 0x1000; address < 0x1000 + 48; address++) {
+        for (size_t size = 0; size < 128; size++) {
+            Check_Split<16, 16>(address, size, split<16>(address, size));
+            Check_Split<16, 4>(address, size, split<16, 4>(address, size));
+        }
+    }
+}
+
+TEST_CASE("split examples", "[fastcopy][dispatch]")
+{
+    static_assert(split<16>(0x1000, 40).head == 0 && split<16>(0x1000, 40).body == 32);
+
+    Split sp = split<16>(0x1003, 40);
+    TEST_ASSERT_EQUAL(13, sp.head);
+    TEST_ASSERT_EQUAL(16, sp.body);
+    TEST_ASSERT_EQUAL(11, sp.tail);
+
+    // Ends before the boundary: all head.
+    sp = split<16>(0x1003, 5);
+    TEST_ASSERT_EQUAL(5, sp.head);
+    TEST_ASSERT_EQUAL(0, sp.body);
+    TEST_ASSERT_EQUAL(0, sp.tail);
+
+    // The fill's split: 16-byte aligned start, word sized body.
+    sp = split<16, 4>(0x1001, 22);
+    TEST_ASSERT_EQUAL(15, sp.head);
+    TEST_ASSERT_EQUAL(4, sp.body);
+    TEST_ASSERT_EQUAL(3, sp.tail);
+}
+
+TEST_CASE("overlaps", "[fastcopy][dispatch]")
+{
+    TEST_ASSERT_FALSE(overlaps(0x1000, 0x1010, 16));
+    TEST_ASSERT_FALSE(overlaps(0x1010, 0x1000, 16));
+    TEST_ASSERT_TRUE(overlaps(0x1000, 0x100f, 16));
+    TEST_ASSERT_TRUE(overlaps(0x100f, 0x1000, 16));
+    TEST_ASSERT_TRUE(overlaps(0x1000, 0x1000, 1));
+    TEST_ASSERT_FALSE(overlaps(0x1000, 0x1000, 0));
+}
+
+TEST_CASE("copy_path picks the PIE within internal RAM", "[fastcopy][dispatch]")
+{
+    const CopyContext internal = { false, false, false, true, true };
+
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, PIE_MIN - 1, internal) == CopyPath::Libc);
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, 0, internal) == CopyPath::Libc);
+
+    // Pie32 needs the addresses and the size all on 32 bytes.
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, 1024, internal) == CopyPath::Pie32);
+    TEST_ASSERT_TRUE(copy_path(0x1010, 0x2000, 1024, internal) == CopyPath::PieUnaligned);
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2001, 1024, internal) == CopyPath::PieUnaligned);
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, 1025, internal) == CopyPath::PieUnaligned);
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, PIE_MIN, internal) == ((PIE_MIN & 0x1f) ? CopyPath::PieUnaligned : CopyPath::Pie32));
+
+    // Not from an ISR or a critical section.
+    const CopyContext isr = { false, false, false, false, false };
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, 1024, isr) == CopyPath::Libc);
+}
+
+TEST_CASE("copy_path only uses the DMA for large PSRAM copies when it may block", "[fastcopy][dispatch]")
+{
+    const CopyContext psram = { true, true, true, true, true };
+
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, psram) == CopyPath::Hybrid);
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN - 1, psram) == CopyPath::Libc);
+
+    CopyContext ctx = psram;
+    ctx.dmaCapable = false;
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, ctx) == CopyPath::Libc);
+
+    ctx = psram;
+    ctx.canBlock = false;
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, ctx) == CopyPath::Libc);
+
+    ctx = psram;
+    ctx.canUsePie = false;
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, ctx) == CopyPath::Libc);
+
+    // One side in internal RAM is bound by the PSRAM bus either way.
+    ctx = psram;
+    ctx.extSrc = false;
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, ctx) == CopyPath::Libc);
+    ctx = psram;
+    ctx.extDest = false;
+    TEST_ASSERT_TRUE(copy_path(0x1000, 0x2000, DMA_MIN, ctx) == CopyPath::Libc);
+}
+
+TEST_CASE("move_path copies buffers that don't overlap", "[fastcopy][dispatch]")
+{
+    TEST_ASSERT_TRUE(move_path(0x1000, 0x2000, 1024, true) == MovePath::Copy);
+    TEST_ASSERT_TRUE(move_path(0x1000, 0x2000, 1024, false) == MovePath::Copy);
+    TEST_ASSERT_TRUE(move_path(0x1000, 0x1000 + PIE_MIN, PIE_MIN, true) == MovePath::Copy);
+
+    TEST_ASSERT_TRUE(move_path(0x1001, 0x1000, PIE_MIN, true) == MovePath::Pie);
+    TEST_ASSERT_TRUE(move_path(0x1000, 0x1001, PIE_MIN, true) == MovePath::Pie);
+    TEST_ASSERT_TRUE(move_path(0x1001, 0x1000, PIE_MIN - 1, true) == MovePath::Libc);
+    TEST_ASSERT_TRUE(move_path(0x1001, 0x1000, PIE_MIN, false) == MovePath::Libc);
+}
+
+TEST_CASE("fill_uses_pie only for internal RAM", "[fastcopy][dispatch]")
+{
+    TEST_ASSERT_TRUE(fill_uses_pie(PIE_MIN, false, true));
+    TEST_ASSERT_FALSE(fill_uses_pie(PIE_MIN - 1, false, true));
+    TEST_ASSERT_FALSE(fill_uses_pie(PIE_MIN, true, true));
+    TEST_ASSERT_FALSE(fill_uses_pie(PIE_MIN, false, false));
+}
+
+TEST_CASE("size_class is the smallest class that fits", "[fastcopy][dispatch]")
+{
+    static const size_t minSizes[] = { 1, 32, 1024, 4096 };
+
+    for (size_t minSize : minSizes) {
+        for (size_t size = 0; size < 64 * minSize; size += size < 4 * minSize ? 1 : minSize / 2 + 1) {
+            const uint32_t c = size_class(size, minSize);
+            TEST_ASSERT_TRUE(size <= (minSize << c));
+            if (c != 0)
+                TEST_ASSERT_TRUE(size > (minSize << (c - 1)));
+        }
+    }
+
+    TEST_ASSERT_EQUAL(0, size_class(0, 1024));
+    TEST_ASSERT_EQUAL(0, size_class(1024, 1024));
+    TEST_ASSERT_EQUAL(1, size_class(1025, 1024));
+    TEST_ASSERT_EQUAL(2, size_class(4096, 1024));
+
+    // No wrap around near SIZE_MAX: it needs a class beyond any pool.
+    TEST_ASSERT_EQUAL(sizeof(size_t) * 8 - 10, size_class(SIZE_MAX, 1024));
+    TEST_ASSERT_EQUAL(sizeof(size_t) * 8, size_class(SIZE_MAX, 1));
+}
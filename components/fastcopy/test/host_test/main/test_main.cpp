@@ -0,0 +1,14 @@
+/*
+* Runs every fastcopy TEST_CASE and exits with the number of failures.
+*/
+
+#include <stdlib.h>
+
+#include "unity.h"
+
+extern "C" void app_main(void)
+{
+    UNITY_BEGIN();
+    unity_run_all_tests();
+    exit(UNITY_END());
+}
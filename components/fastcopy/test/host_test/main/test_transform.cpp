@@ -0,0 +1,132 @@
+/*
+* copy_swap16(), copy_swap32(), copy_mask() and convert_rgb888_rgb565() against
+* a byte-wise reference, for every offset of either buffer within 16 bytes and
+* sizes that aren't whole values, blocks or pixel groups.
+*
+* On the host these run the CPU versions, which on the target also do the head
+* and tail around the PIE blocks; the PIE kernels are target-only.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "unity.h"
+
+#include "fastcopy/transform.hpp"
+
+using namespace fastcopy;
+
+/// @brief Sizes to test, in bytes for the copies and in pixels for the conversion
+static const size_t sizes[] = {
+    0, 1, 2, 3, 4, 5, 7, 9, 15, 16, 17, 31, 33, 47, 63, 65, 95, 97, 127, 129, 255, 257, 1023, 1025,
+};
+
+/// @brief Offsets tried for each buffer, from a 16-byte boundary
+static const size_t MAX_OFFSET = 16;
+
+/// @brief Bytes around the tested range that must be left alone
+static const size_t GUARD = 32;
+
+/// @brief Room for 1025 RGB888 pixels at the largest offset, with guards
+static const size_t BUFFER_SIZE = 3 * 1025 + MAX_OFFSET + 2 * GUARD;
+
+alignas(16) static uint8_t source[BUFFER_SIZE];
+alignas(16) static uint8_t expected[BUFFER_SIZE];
+alignas(16) static uint8_t actual[BUFFER_SIZE];
+
+/// @brief Fills the first \p length bytes of \p buffer with a pattern that differs for each \p seed
+static void fill(uint8_t* buffer, size_t length, uint32_t seed)
+{
+    for (size_t i = 0; i < length; i++)
+        buffer[i] = (uint8_t)(i * 7 + seed * 13 + (i >> 8));
+}
+
+/// @brief Runs \p copy and \p reference for every size and pair of offsets and compares the whole buffers
+template<typename Copy, typename Reference>
+static void Check_Transform(const char* name, size_t bytesPerUnit, const Copy& copy, const Reference& reference)
+{
+    for (size_t size : sizes) {
+        const size_t length = size * bytesPerUnit + MAX_OFFSET + 2 * GUARD;
+        fill(source, length, 1);
+
+        for (size_t s = 0; s < MAX_OFFSET; s++) {
+            for (size_t d = 0; d < MAX_OFFSET; d++) {
+                fill(expected, length, 2);
+                fill(actual, length, 2);
+                copy(actual + GUARD + d, source + GUARD + s, size);
+                reference(expected + GUARD + d, source + GUARD + s, size);
+                TEST_ASSERT_EQUAL_HEX8_ARRAY_MESSAGE(expected, actual, length, name);
+            }
+        }
+    }
+}
+
+TEST_CASE("copy_swap16 swaps the bytes of whole 16-bit values", "[fastcopy][transform]")
+{
+    Check_Transform("copy_swap16", 1, copy_swap16, [](uint8_t* dest, const uint8_t* src, size_t size) {
+        for (size_t i = 0; i + 2 <= size; i += 2) {
+            dest[i] = src[i + 1];
+            dest[i + 1] = src[i];
+        }
+    });
+}
+
+TEST_CASE("copy_swap32 reverses the bytes of whole 32-bit values", "[fastcopy][transform]")
+{
+    Check_Transform("copy_swap32", 1, copy_swap32, [](uint8_t* dest, const uint8_t* src, size_t size) {
+        for (size_t i = 0; i + 4 <= size; i += 4) {
+            for (size_t b = 0; b < 4; b++)
+                dest[i + b] = src[i + 3 - b];
+        }
+    });
+}
+
+TEST_CASE("copy_mask masks and flips whole 32-bit words", "[fastcopy][transform]")
+{
+    // Little endian: the first byte of each word is its low byte.
+    static const uint8_t andBytes[4] = { 0xff, 0x0f, 0xf0, 0x00 };
+    static const uint8_t xorBytes[4] = { 0x5a, 0x00, 0xff, 0x80 };
+
+    Check_Transform("copy_mask", 1,
+        [](void* dest, const void* src, size_t size) { copy_mask(dest, src, size, 0x00f00fff, 0x80ff005a); },
+        [](uint8_t* dest, const uint8_t* src, size_t size) {
+            for (size_t i = 0; i + 4 <= size; i += 4) {
+                for (size_t b = 0; b < 4; b++)
+                    dest[i + b] = (src[i + b] & andBytes[b]) ^ xorBytes[b];
+            }
+        });
+}
+
+/// @brief The RGB565 value of one RGB888 pixel
+static uint16_t Rgb565(const uint8_t* pixel)
+{
+    return (uint16_t)(((pixel[0] >> 3) << 11) | ((pixel[1] >> 2) << 5) | (pixel[2] >> 3));
+}
+
+TEST_CASE("convert_rgb888_rgb565 converts every pixel", "[fastcopy][transform]")
+{
+    Check_Transform("convert_rgb888_rgb565", 3,
+        [](void* dest, const void* src, size_t pixels) { convert_rgb888_rgb565(dest, src, pixels); },
+        [](uint8_t* dest, const uint8_t* src, size_t pixels) {
+            for (size_t p = 0; p < pixels; p++) {
+                const uint16_t v = Rgb565(src + 3 * p);
+                dest[2 * p] = (uint8_t)v;
+                dest[2 * p + 1] = (uint8_t)(v >> 8);
+            }
+        });
+}
+
+TEST_CASE("convert_rgb888_rgb565 swapped stores the high byte first", "[fastcopy][transform]")
+{
+    Check_Transform("convert_rgb888_rgb565 swap", 3,
+        [](void* dest, const void* src, size_t pixels) { convert_rgb888_rgb565(dest, src, pixels, true); },
+        [](uint8_t* dest, const uint8_t* src, size_t pixels) {
+            for (size_t p = 0; p < pixels; p++) {
+                const uint16_t v = Rgb565(src + 3 * p);
+                dest[2 * p] = (uint8_t)(v >> 8);
+                dest[2 * p + 1] = (uint8_t)v;
+            }
+        });
+}
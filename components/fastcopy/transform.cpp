@@ -0,0 +1,297 @@
+/*
+* Copy-and-transform kernels.
+*
+* The PIE kernels do the byte swaps with 32-bit lane shifts and masks:
+* ((x << 8) & 0xff00ff00) | ((x >> 8) & 0x00ff00ff) swaps the bytes of both
+* halves of a word, and rotating that by 16 bits reverses the whole word.
+* The right shift is arithmetic, so its result is always masked.
+*
+* RGB888 has no 16-byte structure the PIE could work on without a shuffle for
+* every block, so the conversion loads 3 words for 4 pixels and stores 2.
+*
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "fastcopy/transform.hpp"
+
+#if FASTCOPY_HAS_PIE
+#include "fastcopy/pie.hpp"
+#include "fastcopy/dispatch.hpp"
+#endif
+
+namespace fastcopy {
+
+static inline uint16_t swap16(uint16_t v) {
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static inline uint32_t swap32(uint32_t v) {
+    return (v << 24) | ((v << 8) & 0x00ff0000) | ((v >> 8) & 0x0000ff00) | (v >> 24);
+}
+
+// The CPU versions, also used for the head and tail around the PIE blocks.
+// memcpy() keeps the loads and stores legal for any alignment.
+
+static void swap16_cpu(uint8_t* dest, const uint8_t* source, size_t size)
+{
+    for(size_t i = 0; i < size; i += sizeof(uint16_t)) {
+        uint16_t v;
+        memcpy(&v, source + i, sizeof(v));
+        v = swap16(v);
+        memcpy(dest + i, &v, sizeof(v));
+    }
+}
+
+static void swap32_cpu(uint8_t* dest, const uint8_t* source, size_t size)
+{
+    for(size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        uint32_t v;
+        memcpy(&v, source + i, sizeof(v));
+        v = swap32(v);
+        memcpy(dest + i, &v, sizeof(v));
+    }
+}
+
+static void mask_cpu(uint8_t* dest, const uint8_t* source, size_t size, uint32_t andMask, uint32_t xorMask)
+{
+    for(size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        uint32_t v;
+        memcpy(&v, source + i, sizeof(v));
+        v = (v & andMask) ^ xorMask;
+        memcpy(dest + i, &v, sizeof(v));
+    }
+}
+
+#if FASTCOPY_HAS_PIE
+
+/*
+    q<D> = q<S> with the bytes of every 16-bit value swapped. q<S> is clobbered.
+    Needs 0xff00ff00 in q6 and 0x00ff00ff in q7.
+*/
+template<uint8_t D, uint8_t S>
+static IRAM_ATTR inline void INL swap16_q() {
+    vsl_32<D,S,8>();
+    vsr_32<S,S,8>();
+    and_q<D,D,6>();
+    and_q<S,S,7>();
+    or_q<D,D,S>();
+}
+
+/*
+    q<D> = q<S> with the bytes of every 32-bit value reversed. q<S> is clobbered.
+    Needs 0x0000ffff in q5 and the swap16_q() masks.
+*/
+template<uint8_t D, uint8_t S>
+static IRAM_ATTR inline void INL swap32_q() {
+    swap16_q<D,S>();
+    vsl_32<S,D,16>();
+    vsr_32<D,D,16>();
+    and_q<D,D,5>();
+    or_q<D,D,S>();
+}
+
+static const uint32_t MASK_HI8 = 0xff00ff00;
+static const uint32_t MASK_LO8 = 0x00ff00ff;
+static const uint32_t MASK_LO16 = 0x0000ffff;
+
+/// @brief Whole 16-byte blocks, both buffers 16-byte aligned
+static IRAM_ATTR void swap16_pie(uint8_t* dest, const uint8_t* source, size_t size)
+{
+    const uint32_t blocks = size / 16;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    vldbc_32<6>(&MASK_HI8);
+    vldbc_32<7>(&MASK_LO8);
+
+    // Two blocks per iteration so the second load covers the latency of the first.
+    rpt(blocks / 2, [&src_p,&dest_p]() {
+        vld_128_ip<0>(src_p);
+        vld_128_ip<2>(src_p);
+        swap16_q<1,0>();
+        swap16_q<3,2>();
+        vst_128_ip<1>(dest_p);
+        vst_128_ip<3>(dest_p);
+    });
+    if(blocks & 1) {
+        vld_128_ip<0>(src_p);
+        swap16_q<1,0>();
+        vst_128_ip<1>(dest_p);
+    }
+}
+
+/// @brief Whole 16-byte blocks, both buffers 16-byte aligned
+static IRAM_ATTR void swap32_pie(uint8_t* dest, const uint8_t* source, size_t size)
+{
+    const uint32_t blocks = size / 16;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    vldbc_32<5>(&MASK_LO16);
+    vldbc_32<6>(&MASK_HI8);
+    vldbc_32<7>(&MASK_LO8);
+
+    rpt(blocks / 2, [&src_p,&dest_p]() {
+        vld_128_ip<0>(src_p);
+        vld_128_ip<2>(src_p);
+        swap32_q<1,0>();
+        swap32_q<3,2>();
+        vst_128_ip<1>(dest_p);
+        vst_128_ip<3>(dest_p);
+    });
+    if(blocks & 1) {
+        vld_128_ip<0>(src_p);
+        swap32_q<1,0>();
+        vst_128_ip<1>(dest_p);
+    }
+}
+
+/// @brief Whole 16-byte blocks, both buffers 16-byte aligned
+static IRAM_ATTR void mask_pie(uint8_t* dest, const uint8_t* source, size_t size, uint32_t andMask, uint32_t xorMask)
+{
+    const uint32_t blocks = size / 16;
+    const void* src_p = source;
+    void* dest_p = dest;
+
+    vldbc_32<6>(&andMask);
+    vldbc_32<7>(&xorMask);
+
+    rpt(blocks / 2, [&src_p,&dest_p]() {
+        vld_128_ip<0>(src_p);
+        vld_128_ip<1>(src_p);
+        and_q<0,0,6>();
+        and_q<1,1,6>();
+        xor_q<0,0,7>();
+        xor_q<1,1,7>();
+        vst_128_ip<0>(dest_p);
+        vst_128_ip<1>(dest_p);
+    });
+    if(blocks & 1) {
+        vld_128_ip<0>(src_p);
+        and_q<0,0,6>();
+        xor_q<0,0,7>();
+        vst_128_ip<0>(dest_p);
+    }
+}
+
+#endif
+
+/// @brief Runs \p pie on the whole 16-byte blocks and \p cpu on the rest, provided both buffers
+/// share the same offset from a 16-byte boundary and the head before the first block is whole units.
+/// Otherwise \p cpu does everything.
+template<size_t Unit, typename Cpu, typename Pie>
+static inline void transform(void* dest, const void* source, size_t size, const Cpu& cpu, const Pie& pie)
+{
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)source;
+    size -= size % Unit;
+
+#if FASTCOPY_HAS_PIE
+    const Split sp = split<16>((uintptr_t)d, size);
+    if(size >= sp.head + 32 && (((uintptr_t)d ^ (uintptr_t)s) & 0xf) == 0 && sp.head % Unit == 0) {
+        cpu(d, s, sp.head);
+        pie(d + sp.head, s + sp.head, sp.body);
+        d += sp.head + sp.body;
+        s += sp.head + sp.body;
+        size = sp.tail;
+    }
+#else
+    (void)pie;
+#endif
+
+    cpu(d, s, size);
+}
+
+void copy_swap16(void* dest, const void* source, size_t size)
+{
+#if FASTCOPY_HAS_PIE
+    transform<sizeof(uint16_t)>(dest, source, size, swap16_cpu, swap16_pie);
+#else
+    transform<sizeof(uint16_t)>(dest, source, size, swap16_cpu, nullptr);
+#endif
+}
+
+void copy_swap32(void* dest, const void* source, size_t size)
+{
+#if FASTCOPY_HAS_PIE
+    transform<sizeof(uint32_t)>(dest, source, size, swap32_cpu, swap32_pie);
+#else
+    transform<sizeof(uint32_t)>(dest, source, size, swap32_cpu, nullptr);
+#endif
+}
+
+void copy_mask(void* dest, const void* source, size_t size, uint32_t andMask, uint32_t xorMask)
+{
+    auto cpu = [andMask, xorMask](uint8_t* d, const uint8_t* s, size_t len) {
+        mask_cpu(d, s, len, andMask, xorMask);
+    };
+#if FASTCOPY_HAS_PIE
+    auto pie = [andMask, xorMask](uint8_t* d, const uint8_t* s, size_t len) {
+        mask_pie(d, s, len, andMask, xorMask);
+    };
+    transform<sizeof(uint32_t)>(dest, source, size, cpu, pie);
+#else
+    transform<sizeof(uint32_t)>(dest, source, size, cpu, nullptr);
+#endif
+}
+
+
+static inline uint32_t rgb565(uint32_t r, uint32_t g, uint32_t b) {
+    return ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | ((b & 0xff) >> 3);
+}
+
+template<bool Swap>
+static inline uint32_t rgb565_pair(uint32_t first, uint32_t second) {
+    if constexpr (Swap) {
+        first = swap16((uint16_t)first);
+        second = swap16((uint16_t)second);
+    }
+    return first | (second << 16);
+}
+
+template<bool Swap>
+static void rgb888_rgb565(uint8_t* dest, const uint8_t* source, size_t pixels)
+{
+    if((((uintptr_t)dest | (uintptr_t)source) & 3) == 0) {
+        // 4 pixels: R0 G0 B0 R1 | G1 B1 R2 G2 | B2 R3 G3 B3, little endian.
+        // All three words are read before anything is written, which keeps this safe in place.
+        const uint32_t* src_w = (const uint32_t*)source;
+        uint32_t* dest_w = (uint32_t*)dest;
+        for(size_t n = pixels / 4; n != 0; n--) {
+            const uint32_t w0 = src_w[0];
+            const uint32_t w1 = src_w[1];
+            const uint32_t w2 = src_w[2];
+            src_w += 3;
+            dest_w[0] = rgb565_pair<Swap>(rgb565(w0, w0 >> 8, w0 >> 16), rgb565(w0 >> 24, w1, w1 >> 8));
+            dest_w[1] = rgb565_pair<Swap>(rgb565(w1 >> 16, w1 >> 24, w2), rgb565(w2 >> 8, w2 >> 16, w2 >> 24));
+            dest_w += 2;
+        }
+        dest = (uint8_t*)dest_w;
+        source = (const uint8_t*)src_w;
+        pixels &= 3;
+    }
+
+    for(; pixels != 0; pixels--) {
+        uint16_t v = rgb565(source[0], source[1], source[2]);
+        if constexpr (Swap) {
+            v = swap16(v);
+        }
+        memcpy(dest, &v, sizeof(v));
+        source += 3;
+        dest += 2;
+    }
+}
+
+void convert_rgb888_rgb565(void* dest, const void* source, size_t pixels, bool swap)
+{
+    if(swap) {
+        rgb888_rgb565<true>((uint8_t*)dest, (const uint8_t*)source, pixels);
+    } else {
+        rgb888_rgb565<false>((uint8_t*)dest, (const uint8_t*)source, pixels);
+    }
+}
+
+} // namespace fastcopy
@@ -0,0 +1,232 @@
+/*
+* Shared declarations for the memory copy benchmark modes.
+*
+* main.cpp holds the original single-size copy test and the reporting helpers,
+* the other files in this directory each add one benchmark mode on top.
+*
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#include "esp_err.h"
+
+
+// Uncomment to use the PSRAM cache
+#define USE_CACHE 
+
+// Uncomment to count instructions and stalls with the LX7 performance counters
+// around every copy of the single-size test. Each copy is then run once per pair of events.
+// #define USE_PERFMON
+
+// Benchmark modes run by app_main. Uncomment the ones to run.
+#define RUN_COPY_V1
+// #define RUN_SIZE_SWEEP
+// #define RUN_UNALIGNED
+// #define RUN_STATS
+// #define RUN_DMA_SERVICE
+// #define RUN_HYBRID
+// #define RUN_PARALLEL
+// #define RUN_FILL
+// #define RUN_BLIT
+// #define RUN_STREAM
+// #define RUN_PREFETCH
+// #define RUN_PHASES
+// #define RUN_CACHE_SYNC
+// #define RUN_UNROLL
+// #define RUN_SMALL
+// #define RUN_PLACEMENT
+// #define RUN_CONTENTION
+// #define RUN_MOVE
+// #define RUN_POOL
+// #define RUN_BOUNCE
+// #define RUN_TRANSFORM
+// #define RUN_CHUNKED
+// #define RUN_CORO
+// #define RUN_FREQUENCY
+
+
+/// @brief A copy kernel under test. Copies \p size bytes from \p source to \p dest.
+typedef void (*CopyKernel)(void* dest, const void* source, size_t size);
+
+/// @brief A copy method as run by the benchmark modes
+struct CopyMethod {
+    /// @brief Name used in the debug messages, e.g. "memcpy "
+    const char* name;
+    /// @brief The kernel to run
+    CopyKernel kernel;
+    /// @brief Sizes must be a multiple of this for the kernel to copy everything.
+    /// Addresses must be aligned to this, up to 16 bytes.
+    uint32_t granularity;
+    /// @brief \c true if the CPU does the copy, so the PSRAM cache needs preparing and flushing around it
+    bool cpu;
+    /// @brief \c true if this method dispatches to one of the others, so it is never "the best method"
+    bool dispatch;
+};
+
+/// @brief All the copy methods, in the same order as the original single-size test
+extern const CopyMethod copyMethods[];
+extern const size_t copyMethodCount;
+
+/// @brief A source/destination memory region combination
+struct RegionPair {
+    /// @brief Used in the debug messages, e.g. "IRAM->PSRAM"
+    const char* desc;
+    /// @brief heap_caps flags for the destination buffer
+    uint32_t destCaps;
+    /// @brief heap_caps flags for the source buffer
+    uint32_t sourceCaps;
+};
+
+/// @brief IRAM->IRAM, IRAM->PSRAM, PSRAM->IRAM and PSRAM->PSRAM
+extern const RegionPair regionPairs[];
+extern const size_t regionPairCount;
+
+/// @brief Looks up a method by name, ignoring the trailing space
+/// @return the method, or \c nullptr if there is none by that name
+const CopyMethod* Find_Method(const char* name);
+
+/// @brief Returns the method name without the trailing space, for tables
+std::string Method_Label(const CopyMethod& method);
+
+/// @brief Checks whether \p method can copy \p size bytes between \p dest and \p source
+bool Method_Supports(const CopyMethod& method, void* dest, void* source, size_t size);
+
+/// @brief Cycles spent in each phase of a copy
+struct CopyPhases {
+    /// @brief Getting the PSRAM cache ready before the copy, not part of the copy time
+    uint32_t prepare;
+    /// @brief The kernel itself
+    uint32_t kernel;
+    /// @brief Writing a PSRAM destination back from the cache
+    uint32_t flush;
+    /// @brief Checking the result, filled in by the caller
+    uint32_t verify;
+};
+
+/// @brief Runs \p method once with the same cache preparation and flushing as the single-size test
+/// @param phases if given, receives the time of the prepare, kernel and flush phases
+/// @return the number of CPU cycles taken, including the cache flush
+uint32_t Time_Copy(const CopyMethod& method, void* dest, void* source, size_t size, bool useCache,
+                   CopyPhases* phases = nullptr);
+
+
+/// @brief Settings for the statistical runner
+struct RunnerConfig {
+    /// @brief Runs done and discarded before sampling, to settle the caches and branch predictors
+    uint32_t warmup;
+    /// @brief Number of samples taken
+    uint32_t repetitions;
+    /// @brief Samples further than this many median absolute deviations from the median are rejected
+    float outlierLimit;
+};
+
+/// @brief Summary of a set of cycle count samples
+struct CycleStats {
+    /// @brief Over all samples
+    uint32_t min, median, p99, max;
+    /// @brief Over the samples left after outlier rejection
+    float mean, stddev;
+    /// @brief Half width of the 95% confidence interval of the mean, in cycles
+    float ci95;
+    uint32_t samples;
+    uint32_t rejected;
+};
+
+/// @brief Summarises \p count cycle count samples. Sorts \p samples in place.
+CycleStats Compute_Stats(uint32_t* samples, size_t count, float outlierLimit);
+
+/// @brief Runs \p method with warmup and repetitions as set by \p config, clearing \p dest before each run
+/// @return \c false if the method doesn't support these buffers or the result didn't match
+bool Run_Method(const CopyMethod& method, void* dest, void* source, size_t size, bool useCache,
+                const RunnerConfig& config, CycleStats& stats);
+
+/// @brief Logs \p stats with the bandwidth at the median
+void Display_Stats(std::string prefix, std::string desc, const CycleStats& stats, uint32_t size);
+
+/// @brief Checks whether the means of \p a and \p b differ significantly (Welch's t-test, 95%)
+bool Is_Significant(const CycleStats& a, const CycleStats& b);
+
+
+// Reporting helpers, in main.cpp
+void Initialize_Buffer(void *buffer, uint32_t size);
+void clearBuffer(void* dest, size_t size);
+float Calc_MBps(uint32_t cycles, uint32_t size);
+std::string Calc_Bandwidth(uint32_t tstart, uint32_t tstop, uint32_t size);
+void Display_Performance(std::string prefix, std::string desc, uint32_t tstart, uint32_t tstop, uint32_t size);
+void Display_Results(std::string prefix, std::string desc, uint32_t tstart, uint32_t tstop,
+                     void* dest, void* source, uint32_t size);
+
+
+// Buffer pools for the region pair loops, in buffers.cpp
+namespace fastcopy { struct BufferPoolStats; }
+/// @brief Reserves \p iramBuffers buffers of \p size bytes in IRAM and \p psramBuffers in PSRAM, which
+/// Buffer_Acquire() hands out for any size up to \p size instead of allocating from the heap.
+/// By default two of each, the source and destination of an IRAM->IRAM or PSRAM->PSRAM pair; 0 reserves none.
+void Buffers_Start(size_t size, uint32_t iramBuffers = 2, uint32_t psramBuffers = 2);
+/// @brief Logs the pools' statistics and frees them
+void Buffers_Stop();
+/// @brief Like heap_caps_aligned_alloc, but from the IRAM or PSRAM pool when \p caps and \p align allow
+void* Buffer_Acquire(uint32_t align, size_t size, uint32_t caps);
+/// @brief Returns \p buffer to its pool, or frees it if it came from the heap
+void Buffer_Release(void* buffer);
+/// @brief Logs acquire/release latency and fragmentation of a pool
+void Display_Pool_Stats(std::string desc, const fastcopy::BufferPoolStats& stats);
+
+// Performance counters, in perfmon.cpp. Without USE_PERFMON these do nothing.
+#ifdef USE_PERFMON
+/// @brief Number of runs needed to count every event
+uint32_t Perf_Group_Count();
+/// @brief Selects the events counted by the next Perf_Begin()/Perf_End(). Group 0 starts a new copy.
+void Perf_Select(uint32_t group);
+void Perf_Begin();
+void Perf_End();
+/// @brief Logs the counters once the last group has been counted
+void Perf_Report(std::string prefix, std::string desc, uint32_t cycles);
+#else
+static inline uint32_t Perf_Group_Count() { return 1; }
+static inline void Perf_Select(uint32_t) {}
+static inline void Perf_Begin() {}
+static inline void Perf_End() {}
+static inline void Perf_Report(std::string, std::string, uint32_t) {}
+#endif
+
+
+// Benchmark modes
+void MemoryCopy_V1(uint32_t size, uint32_t align);
+void MemoryCopy_Sweep(uint32_t minSize, uint32_t maxSize, uint32_t align);
+void MemoryCopy_Unaligned(uint32_t size, uint32_t align);
+void MemoryCopy_Stats(uint32_t size, uint32_t align, const RunnerConfig& config);
+void MemoryCopy_DmaService(uint32_t size, uint32_t chunk, uint32_t align);
+void MemoryCopy_Hybrid(uint32_t size, uint32_t align);
+void MemoryCopy_Parallel(uint32_t align);
+void MemoryFill(uint32_t size, uint32_t align);
+void MemoryCopy_Blit(uint32_t align);
+void MemoryCopy_Stream(uint32_t size, uint32_t align);
+void MemoryCopy_Prefetch(uint32_t size, uint32_t align);
+void MemoryCopy_Phases(uint32_t size, uint32_t align);
+void Cache_Sync_Compare(uint32_t align);
+void MemoryCopy_Unroll(uint32_t size, uint32_t align, const RunnerConfig& config);
+void MemoryCopy_Small(uint32_t align);
+void MemoryCopy_Placement(uint32_t size, uint32_t align, const RunnerConfig& config);
+
+/// @brief Background loads for MemoryCopy_Contention(), run on the other core
+enum ContentionLoad : uint32_t {
+    LOAD_NONE         = 0,
+    LOAD_PSRAM_READ   = 1 << 0,
+    LOAD_PSRAM_WRITE  = 1 << 1,
+    LOAD_CACHE_THRASH = 1 << 2,
+    LOAD_DMA          = 1 << 3,
+    LOAD_ALL          = LOAD_PSRAM_READ | LOAD_PSRAM_WRITE | LOAD_CACHE_THRASH | LOAD_DMA,
+};
+void MemoryCopy_Contention(uint32_t size, uint32_t align, const RunnerConfig& config, uint32_t loads);
+void MemoryMove(uint32_t size, uint32_t align);
+void Buffer_Pool_Compare();
+void MemoryCopy_Bounce(uint32_t size, uint32_t align, const RunnerConfig& config);
+void MemoryCopy_Transform(uint32_t size, uint32_t align);
+void MemoryCopy_Chunked(uint32_t size, uint32_t align);
+void MemoryCopy_Coro(uint32_t size, uint32_t align);
+void MemoryCopy_Frequency(uint32_t size, uint32_t align, const RunnerConfig& config);
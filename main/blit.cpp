@@ -0,0 +1,170 @@
+/*
+* Blit test: copies a rectangle between two framebuffers with the 2D kernels,
+* for the widths of common small displays at 16 bits per pixel.
+*
+* "memcpy per row" is what the application did before the 2D kernels existed,
+* and is also what copy_2d_memcpy() does; the PIE and DMA kernels are compared
+* against it. Every region pair is run, so PSRAM framebuffers to IRAM line
+* buffers and back are both covered.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/compare.hpp"
+#include "fastcopy/blit.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Blit";
+
+/// @brief Bytes per pixel (RGB565)
+static const uint32_t BPP = 2;
+
+/// @brief Framebuffer width in pixels, which sets both strides
+static const uint32_t FB_WIDTH = 480;
+static_assert((FB_WIDTH * BPP) % 64 == 0, "Flush_Rect() needs every row to start on a cache line");
+
+/// @brief Rows copied, and the framebuffer height
+static const uint32_t ROWS = 40;
+
+/// @brief Rectangle widths in pixels
+static const uint32_t widths[] = { 240, 320, 480 };
+
+/// @brief A 2D copy kernel under test
+typedef void (*BlitKernel)(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride);
+
+struct BlitMethod {
+    const char* name;
+    BlitKernel kernel;
+    /// @brief \c true if the CPU does the copy, so the PSRAM cache needs flushing after it
+    bool cpu;
+};
+
+
+static IRAM_ATTR void blit_dma(void* dest, const void* source, size_t width, size_t height, size_t destStride, size_t sourceStride) {
+    copy_2d_dma(dest, source, width, height, destStride, sourceStride);
+}
+
+static const BlitMethod blitMethods[] = {
+    { "memcpy per row ",   &copy_2d_memcpy, true  },
+    { "PIE 128-bit 2D ",   &copy_2d_pie,    true  },
+    { "async_memcpy 2D ",  &blit_dma,       false },
+};
+
+
+/// @brief Writes back the cache lines holding each row of the rectangle, leaving the lines between
+/// the rows alone. The stride is whole cache lines, so every row starts on one.
+static IRAM_ATTR void Flush_Rect(void* dest, size_t width, size_t stride)
+{
+    const size_t ls = internal::getCacheLineSize();
+    const size_t rowLines = (width + ls - 1) & ~(ls - 1);
+    for (uint32_t row = 0; row < ROWS; row++)
+        flushCache((uint8_t*)dest + row * stride, rowLines < stride ? rowLines : stride);
+}
+
+
+/// @brief Times one rectangle copy with the same cache preparation and flushing as Time_Copy,
+/// but writing back only the lines of the rectangle rather than the whole framebuffer
+static IRAM_ATTR uint32_t Time_Blit(const BlitMethod& method, void* dest, void* source, size_t fbSize,
+                                    size_t width, size_t stride, bool useCache)
+{
+    const bool needFlush = method.cpu && prepareCache(dest, source, fbSize, useCache);
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    method.kernel(dest, source, width, ROWS, stride, stride);
+
+    if (needFlush) {
+        compiler_mem_barrier(dest, fbSize);
+        Flush_Rect(dest, width, stride);
+    }
+
+    return esp_cpu_get_cycle_count() - tstart;
+}
+
+
+/// @brief Checks every row of the rectangle
+static bool Check_Blit(const void* dest, const void* source, size_t width, size_t stride) {
+    for (uint32_t row = 0; row < ROWS; row++) {
+        if (!fastcopy::equal((const uint8_t*)dest + row * stride, (const uint8_t*)source + row * stride, width))
+            return false;
+    }
+    return true;
+}
+
+
+/// @brief Copies 240, 320 and 480 pixel wide rectangles between framebuffers on every region pair
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Blit(uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    const size_t stride = FB_WIDTH * BPP;
+    const size_t fbSize = stride * ROWS;
+
+    ESP_LOGI(TAG, "\n\nblit test, %" PRIu32 " rows from a %" PRIu32 " pixel wide framebuffer\n", ROWS, FB_WIDTH);
+
+    Buffers_Start(fbSize);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, fbSize, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, fbSize, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, fbSize);
+
+        for (uint32_t w : widths) {
+            const size_t width = w * BPP;
+
+            char desc[48];
+            snprintf(desc, sizeof(desc), "%s %" PRIu32 "x%" PRIu32 " px", pair.desc, w, ROWS);
+
+            for (const BlitMethod& method : blitMethods) {
+                if (!method.cpu && !dma_capable_2d(dest, source, width, ROWS, stride, stride))
+                    continue;
+
+                clearBuffer(dest, fbSize);
+                const uint32_t cycles = Time_Blit(method, dest, source, fbSize, width, stride, useCache);
+                if (Check_Blit(dest, source, width, stride))
+                    Display_Performance(method.name, desc, 0, cycles, width * ROWS);
+                else
+                    ESP_LOGE(TAG, "%s%s failed because the buffers don't match!", method.name, desc);
+
+                // Give the log output some time to finish before the next test is run.
+                vTaskDelay(50/portTICK_PERIOD_MS);
+            }
+            printf("\n");
+        }
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
@@ -0,0 +1,135 @@
+/*
+* Bounce test: PSRAM->PSRAM copies staged through internal RAM tiles, against
+* memcpy straight from PSRAM to PSRAM and async_memcpy.
+*
+* Every tile size runs with the CPU doing both legs, with the DMA fetching the
+* tiles, and with the DMA writing them out. All methods go through the
+* statistical runner with the same cache preparation and flushing.
+*
+* The tiles come from a pool with a size class per tile size, so starting a
+* BounceCopy for each combination doesn't go back to the internal heap.
+*
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/bounce.hpp"
+#include "fastcopy/pool.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Bounce";
+
+/// @brief Tile sizes tried
+static const uint32_t tileSizes[] = { 1024, 4 * 1024, 8 * 1024, 16 * 1024 };
+
+/// @brief Size classes from the smallest tile size to the largest, which double
+static const uint32_t TILE_CLASSES = 5;
+
+static const BounceDma legs[] = { BounceDma::None, BounceDma::Read, BounceDma::Write };
+static const char* const legNames[] = { "CPU only", "DMA read", "DMA write" };
+
+/// @brief The bounce copy being timed, as CopyKernel has no room for it
+static BounceCopy* activeBounce;
+
+static IRAM_ATTR void kernel_bounce(void* dest, const void* source, size_t size) {
+    activeBounce->copy(dest, source, size);
+}
+
+
+/// @brief Copies PSRAM->PSRAM through internal RAM tiles of several sizes, against memcpy and async_memcpy
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+void MemoryCopy_Bounce(uint32_t size, uint32_t align, const RunnerConfig& config)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nPSRAM->PSRAM through internal RAM tiles, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size, 0, 2);
+    void* source = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
+    void* dest = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
+    if(!dest || !source) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffer_Release(source);
+        Buffer_Release(dest);
+        Buffers_Stop();
+        return;
+    }
+
+    // The two tiles of a BounceCopy, in every tile size. Without it the tiles come from the heap.
+    BufferPool tilePool;
+    const BufferPoolConfig tiles = { .caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, .minSize = tileSizes[0],
+                                     .classes = TILE_CLASSES, .buffers = 2 };
+    if (tilePool.start(tiles) != ESP_OK)
+        ESP_LOGW(TAG, "Falling back to the heap for the bounce tiles");
+    Initialize_Buffer(source, size);
+
+    // The baselines
+    float memcpyMbps = 0;
+    for (const char* name : { "memcpy", "async_memcpy" }) {
+        const CopyMethod* method = Find_Method(name);
+        CycleStats stats;
+        if (!method || !Run_Method(*method, dest, source, size, useCache, config, stats))
+            continue;
+        Display_Stats(method->name, "PSRAM->PSRAM", stats, size);
+        if (!memcpyMbps)
+            memcpyMbps = Calc_MBps(stats.median, size);
+        vTaskDelay(50/portTICK_PERIOD_MS);
+    }
+    printf("\n");
+
+    for (uint32_t tileSize : tileSizes) {
+        for (size_t l = 0; l < sizeof(legs) / sizeof(legs[0]); l++) {
+            BounceCopy bounce;
+            if (bounce.start(tileSize, legs[l], tilePool.started() ? &tilePool : nullptr) != ESP_OK)
+                continue;
+            activeBounce = &bounce;
+
+            char name[48];
+            snprintf(name, sizeof(name), "bounce %" PRIu32 "kb %s ", tileSize/1024, legNames[l]);
+            const CopyMethod method = { name, &kernel_bounce, 1, true, false };
+
+            CycleStats stats;
+            if (Run_Method(method, dest, source, size, useCache, config, stats)) {
+                Display_Stats(name, "PSRAM->PSRAM", stats, size);
+                const BounceStats& last = bounce.stats();
+                ESP_LOGI(TAG, "  %" PRIu32 " tiles, CPU leg %" PRIu32 " cycles, waited %" PRIu32 " cycles for the DMA, %+.1f%% against memcpy",
+                         last.tiles, last.cpuCycles, last.waitCycles,
+                         memcpyMbps ? 100.0f * (Calc_MBps(stats.median, size) - memcpyMbps) / memcpyMbps : 0.0f);
+            }
+
+            activeBounce = nullptr;
+            // Give the log output some time to finish before the next test is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+        printf("\n");
+    }
+
+    if (tilePool.started()) {
+        Display_Pool_Stats("bounce tiles", tilePool.stats());
+        tilePool.stop();
+    }
+
+    Buffer_Release(source);
+    Buffer_Release(dest);
+    Buffers_Stop();
+
+}
@@ -0,0 +1,93 @@
+/*
+* Buffer pools for the region pair loops.
+*
+* The benchmark modes take their buffers from an IRAM and a PSRAM
+* fastcopy::BufferPool, reserved once per mode for the largest size it copies,
+* rather than allocating and freeing buffers for every region pair and size.
+* Anything the pools can't serve, e.g. other caps or alignments above a cache
+* line, falls back to the heap.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/pool.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Buffers";
+
+static const uint32_t IRAM_CAPS = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+static const uint32_t PSRAM_CAPS = MALLOC_CAP_SPIRAM;
+
+static BufferPool iramPool;
+static BufferPool psramPool;
+
+
+void Buffers_Start(size_t size, uint32_t iramBuffers, uint32_t psramBuffers)
+{
+    Buffers_Stop();
+    const BufferPoolConfig iram = { .caps = IRAM_CAPS, .minSize = size, .classes = 1, .buffers = iramBuffers };
+    const BufferPoolConfig psram = { .caps = PSRAM_CAPS, .minSize = size, .classes = 1, .buffers = psramBuffers };
+    if(iramBuffers && iramPool.start(iram) != ESP_OK) {
+        ESP_LOGW(TAG, "Falling back to the heap for %u byte IRAM buffers", (unsigned)size);
+    }
+    if(psramBuffers && psramPool.start(psram) != ESP_OK) {
+        ESP_LOGW(TAG, "Falling back to the heap for %u byte PSRAM buffers", (unsigned)size);
+    }
+}
+
+void Buffers_Stop()
+{
+    if(iramPool.started()) {
+        Display_Pool_Stats("IRAM", iramPool.stats());
+        iramPool.stop();
+    }
+    if(psramPool.started()) {
+        Display_Pool_Stats("PSRAM", psramPool.stats());
+        psramPool.stop();
+    }
+}
+
+void* Buffer_Acquire(uint32_t align, size_t size, uint32_t caps)
+{
+    BufferPool* pool = caps == IRAM_CAPS ? &iramPool : caps == PSRAM_CAPS ? &psramPool : nullptr;
+    if(pool && pool->started() && align <= internal::getCacheLineSize()) {
+        void* buffer = pool->acquire(size);
+        if(buffer) {
+            return buffer;
+        }
+    }
+    return heap_caps_aligned_alloc(align, size, caps);
+}
+
+void Buffer_Release(void* buffer)
+{
+    BufferPool* pool = iramPool.owns(buffer) ? &iramPool : psramPool.owns(buffer) ? &psramPool : nullptr;
+    if(!pool) {
+        free(buffer);
+    } else if(!pool->release(buffer)) {
+        ESP_LOGE(TAG, "Pool buffer %p released twice", buffer);
+    }
+}
+
+void Display_Pool_Stats(std::string desc, const BufferPoolStats& stats)
+{
+    ESP_LOGI(TAG, "%s pool: %" PRIu32 " acquired (%" PRIu32 " failed, %" PRIu32 " from a larger class), %" PRIu32 " released twice, "
+                  "acquire %" PRIu32 " (max %" PRIu32 ") cycles, release %" PRIu32 " (max %" PRIu32 ") cycles",
+             desc.c_str(), stats.acquired, stats.failed, stats.spilled, stats.rejected,
+             stats.acquired ? (uint32_t)(stats.acquireCycles / stats.acquired) : 0, stats.maxAcquireCycles,
+             stats.released ? (uint32_t)(stats.releaseCycles / stats.released) : 0, stats.maxReleaseCycles);
+    ESP_LOGI(TAG, "%s pool: peak %" PRIu32 " buffers, %u of %u bytes reserved; in use now %u bytes for %u requested (%.1f%% lost to size classes)",
+             desc.c_str(), stats.peakInUse, (unsigned)stats.peakUsedBytes, (unsigned)stats.reserved,
+             (unsigned)stats.usedBytes, (unsigned)stats.requestedBytes,
+             stats.usedBytes ? 100.0f * (stats.usedBytes - stats.requestedBytes) / stats.usedBytes : 0.0f);
+}
@@ -0,0 +1,128 @@
+/*
+* Cache sync test: esp_cache_msync() against the ROM functions it wraps
+* (fastcopy::internal::writeBack/invalidate), on dirty and on clean PSRAM lines.
+*
+* esp_cache_msync() checks its arguments, takes a lock and works out the cache
+* type before calling into ROM; the ROM calls skip all of that. This shows what
+* the checks cost for a given size.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Cache Sync";
+
+/// @brief Sizes tried, in bytes
+static const uint32_t sizes[] = { 64, 1024, 4 * 1024, 32 * 1024, 100 * 1024 };
+
+/// @brief Samples per measurement; the median is reported
+static const uint32_t SAMPLES = 21;
+
+typedef void (*SyncFunction)(void* addr, size_t size);
+
+/// @brief One cache operation done through both APIs
+struct SyncCompare {
+    const char* name;
+    SyncFunction idf;
+    SyncFunction rom;
+};
+
+
+static IRAM_ATTR void idf_writeBack(void* addr, size_t size) {
+    esp_cache_msync(addr, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+}
+
+static IRAM_ATTR void idf_invalidate(void* addr, size_t size) {
+    esp_cache_msync(addr, size, ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+}
+
+static IRAM_ATTR void idf_writeBackInvalidate(void* addr, size_t size) {
+    esp_cache_msync(addr, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE | ESP_CACHE_MSYNC_FLAG_TYPE_DATA);
+}
+
+static IRAM_ATTR void rom_writeBack(void* addr, size_t size) {
+    internal::writeBack(addr, size);
+}
+
+static IRAM_ATTR void rom_invalidate(void* addr, size_t size) {
+    internal::invalidate(addr, size);
+}
+
+static IRAM_ATTR void rom_writeBackInvalidate(void* addr, size_t size) {
+    internal::writeBack(addr, size);
+    internal::invalidate(addr, size);
+}
+
+static const SyncCompare syncCompares[] = {
+    { "write-back",              &idf_writeBack,           &rom_writeBack           },
+    { "invalidate",              &idf_invalidate,          &rom_invalidate          },
+    { "write-back + invalidate", &idf_writeBackInvalidate, &rom_writeBackInvalidate },
+};
+
+
+/// @brief Median time of \p fn over \p size bytes of \p buffer, with its lines dirty or clean beforehand
+static uint32_t Time_Sync(SyncFunction fn, void* buffer, size_t size, bool dirty)
+{
+    uint32_t samples[SAMPLES];
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        memset(buffer, i, size);
+        if (!dirty)
+            internal::writeBack(buffer, size);
+
+        const uint32_t tstart = esp_cpu_get_cycle_count();
+        fn(buffer, size);
+        samples[i] = esp_cpu_get_cycle_count() - tstart;
+    }
+    return Compute_Stats(samples, SAMPLES, 5.0f).median;
+}
+
+
+/// @brief Compares esp_cache_msync() with the ROM cache functions on a PSRAM buffer
+/// @param align The alignment size to use when allocating the memory
+void Cache_Sync_Compare(uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nesp_cache_msync against the ROM cache functions\n");
+
+    const uint32_t maxSize = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    void* buffer = heap_caps_aligned_alloc(align, maxSize, MALLOC_CAP_SPIRAM);
+    if (!buffer) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        return;
+    }
+
+    for (const SyncCompare& op : syncCompares) {
+        for (bool dirty : { true, false }) {
+            for (uint32_t size : sizes) {
+                const uint32_t idf = Time_Sync(op.idf, buffer, size, dirty);
+                const uint32_t rom = Time_Sync(op.rom, buffer, size, dirty);
+                ESP_LOGI(TAG, "%s, %s, %" PRIu32 " bytes: esp_cache_msync %" PRIu32 ", ROM %" PRIu32 " cycles, %+" PRId32 " cycles (%.1f%%) for the IDF API",
+                         op.name, dirty ? "dirty" : "clean", size, idf, rom,
+                         (int32_t)(idf - rom), rom ? 100.0f * ((float)idf / rom - 1.0f) : 0.0f);
+            }
+
+            // Give the log output some time to finish before the next test is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+        printf("\n");
+    }
+
+    free(buffer);
+
+}
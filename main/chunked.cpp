@@ -0,0 +1,154 @@
+/*
+* Chunked DMA test: multi-MB PSRAM->PSRAM copies through fastcopy::ChunkedDma
+* for a range of chunk sizes and queue depths.
+*
+* The baselines are memcpy and a single copy_dma() of the whole buffer, which
+* is what CopyBuffer_DMA does with one monolithic async_memcpy request. The
+* table gives MB/s per chunk size (rows) and depth (columns), then the CPU
+* time spent on cache maintenance and submitting for the best combination.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/compare.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/chunked.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Chunked DMA";
+
+static const uint32_t chunkSizes[] = { 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 };
+static const uint32_t depths[] = { 1, 2, 4, 8 };
+
+static const size_t CHUNK_COUNT = sizeof(chunkSizes) / sizeof(chunkSizes[0]);
+static const size_t DEPTH_COUNT = sizeof(depths) / sizeof(depths[0]);
+
+
+/// @brief Checks a copy, logging a mismatch
+static bool Check_Copy(void* dest, void* source, uint32_t size, const char* what) {
+    if (!fastcopy::equal(source, dest, size)) {
+        ESP_LOGE(TAG, "%s failed because the buffers don't match!", what);
+        return false;
+    }
+    return true;
+}
+
+
+/// @brief Copies \p size bytes of PSRAM with chunk sizes from 4KB to 1MB and 1 to 8 chunks in flight
+/// @param size The size of the memory to copy, several MB
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Chunked(uint32_t size, uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nchunked DMA, PSRAM->PSRAM %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size, 0, 2);
+    void* source = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
+    void* dest = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
+    if(!dest || !source) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffer_Release(source);
+        Buffer_Release(dest);
+        Buffers_Stop();
+        return;
+    }
+    Initialize_Buffer(source, size);
+
+    // memcpy, writing the destination back so it ends up in PSRAM like the DMA copies
+    clearBuffer(dest, size);
+    uint32_t tstart = esp_cpu_get_cycle_count();
+    memcpy(dest, source, size);
+    flushCache(dest, size);
+    uint32_t tstop = esp_cpu_get_cycle_count();
+    if (Check_Copy(dest, source, size, "memcpy"))
+        Display_Performance("memcpy ", "PSRAM->PSRAM", tstart, tstop, size);
+    vTaskDelay(50/portTICK_PERIOD_MS);
+
+    // One request for the whole buffer
+    clearBuffer(dest, size);
+    const size_t internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    tstart = esp_cpu_get_cycle_count();
+    const esp_err_t r = copy_dma(dest, source, size);
+    tstop = esp_cpu_get_cycle_count();
+    if (r != ESP_OK)
+        ESP_LOGW(TAG, "single copy_dma of %" PRIu32 " bytes failed: %s, with %u bytes of internal DMA capable RAM free",
+                 size, esp_err_to_name(r), (unsigned)internalFree);
+    else if (Check_Copy(dest, source, size, "single copy_dma"))
+        Display_Performance("copy_dma single request ", "PSRAM->PSRAM", tstart, tstop, size);
+    vTaskDelay(50/portTICK_PERIOD_MS);
+
+    float mbps[CHUNK_COUNT][DEPTH_COUNT] = {};
+    ChunkedDmaStats best = {};
+    float bestMbps = 0;
+    uint32_t bestChunk = 0, bestDepth = 0;
+
+    for (size_t c = 0; c < CHUNK_COUNT; c++) {
+        for (size_t d = 0; d < DEPTH_COUNT; d++) {
+            ChunkedDma dma;
+            if (dma.start({ chunkSizes[c], depths[d] }) != ESP_OK)
+                continue;
+
+            clearBuffer(dest, size);
+            tstart = esp_cpu_get_cycle_count();
+            const esp_err_t e = dma.copy(dest, source, size);
+            tstop = esp_cpu_get_cycle_count();
+
+            char what[48];
+            snprintf(what, sizeof(what), "%" PRIu32 "kb x %" PRIu32, chunkSizes[c]/1024, depths[d]);
+            if (e != ESP_OK) {
+                ESP_LOGE(TAG, "%s failed: %s", what, esp_err_to_name(e));
+            } else if (Check_Copy(dest, source, size, what)) {
+                mbps[c][d] = Calc_MBps(tstop - tstart, size);
+                if (mbps[c][d] > bestMbps) {
+                    bestMbps = mbps[c][d];
+                    best = dma.stats();
+                    bestChunk = chunkSizes[c];
+                    bestDepth = depths[d];
+                }
+            }
+            dma.stop();
+
+            // Give the log output some time to finish before the next test is run.
+            vTaskDelay(10/portTICK_PERIOD_MS);
+        }
+    }
+
+    // MB/s, one row per chunk size
+    printf("\nchunk");
+    for (uint32_t depth : depths)
+        printf(",depth %" PRIu32, depth);
+    printf("\n");
+    for (size_t c = 0; c < CHUNK_COUNT; c++) {
+        printf("%" PRIu32, chunkSizes[c]);
+        for (size_t d = 0; d < DEPTH_COUNT; d++)
+            printf(",%.2f", mbps[c][d]);
+        printf("\n");
+    }
+    printf("\n");
+
+    if (bestMbps > 0) {
+        ESP_LOGI(TAG, "best: %" PRIu32 "kb chunks, depth %" PRIu32 ", %.2f MB/s; %" PRIu32 " chunks, CPU busy %" PRIu32 " of %" PRIu32 " cycles (%.1f%%), waiting %" PRIu32,
+                 bestChunk/1024, bestDepth, bestMbps, best.chunks, best.cpuCycles, best.totalCycles,
+                 100.0f * best.cpuCycles / best.totalCycles, best.waitCycles);
+    }
+
+    Buffer_Release(source);
+    Buffer_Release(dest);
+    Buffers_Stop();
+
+}
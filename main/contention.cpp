@@ -0,0 +1,289 @@
+/*
+* Contention test: the copy matrix rerun while a task on the other core keeps
+* the memory system busy.
+*
+* + PSRAM reader: sums a 1MB PSRAM buffer, far larger than the data cache
+* + PSRAM writer: fills the same buffer, so the cache is always writing back
+* + cache thrasher: writes one word per cache line, evicting a dirty line on every access
+* + DMA traffic: back-to-back async_memcpy PSRAM->PSRAM on its own driver
+*
+* Each method runs through the statistical runner on the idle system first and
+* then under each selected load. Reports the median bandwidth and p99 latency
+* against idle, and how much work the load task got done meanwhile.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+using std::vector;
+
+static const char *TAG = "Contention";
+
+/// @brief Size of the PSRAM buffer the load task works on
+static const uint32_t LOAD_BUFFER_SIZE = 1024 * 1024;
+
+/// @brief Size of each async_memcpy request of the DMA load
+static const uint32_t LOAD_DMA_SIZE = 64 * 1024;
+
+/// @brief The load task yields a tick this often (in cycles of its core) to keep the task watchdog fed
+static const uint32_t LOAD_YIELD_CYCLES = 100 * 1000 * 1000;
+
+struct LoadTask {
+    ContentionLoad load;
+    uint8_t* buffer;
+    uint8_t* dmaDest;
+    DmaService* dma;
+    TaskHandle_t task;
+    /// @brief Given by the load task as it exits. Not a task notification, which other
+    /// users of the caller's notification value may have left pending.
+    SemaphoreHandle_t done;
+    volatile bool quit;
+    /// @brief Work done by the load, in bytes, and the time it took on its own core
+    uint64_t bytes;
+    uint64_t cycles;
+};
+
+static const char* Load_Name(ContentionLoad load) {
+    switch(load) {
+        case LOAD_PSRAM_READ:  return "PSRAM reader";
+        case LOAD_PSRAM_WRITE: return "PSRAM writer";
+        case LOAD_CACHE_THRASH: return "cache thrasher";
+        case LOAD_DMA:         return "DMA traffic";
+        default:               return "idle";
+    }
+}
+
+
+/// @brief Calc_MBps() for the 64-bit totals of the load task
+static float Load_MBps(uint64_t cycles, uint64_t bytes) {
+    while(cycles > UINT32_MAX || bytes > UINT32_MAX) {
+        cycles >>= 1;
+        bytes >>= 1;
+    }
+    return Calc_MBps(cycles, bytes);
+}
+
+
+/// @brief One pass of the load over its buffer
+/// @return the number of bytes read, written or copied
+static uint32_t IRAM_ATTR Load_Pass(LoadTask& lt) {
+    volatile uint32_t* words = (volatile uint32_t*)lt.buffer;
+    const uint32_t count = LOAD_BUFFER_SIZE / sizeof(uint32_t);
+
+    switch(lt.load) {
+        case LOAD_PSRAM_READ: {
+            uint32_t sum = 0;
+            for(uint32_t i = 0; i < count; i++) {
+                sum += words[i];
+            }
+            words[0] = sum;
+            return LOAD_BUFFER_SIZE;
+        }
+        case LOAD_PSRAM_WRITE:
+            for(uint32_t i = 0; i < count; i++) {
+                words[i] = i;
+            }
+            return LOAD_BUFFER_SIZE;
+        case LOAD_CACHE_THRASH: {
+            const uint32_t stride = internal::getCacheLineSize() / sizeof(uint32_t);
+            for(uint32_t i = 0; i < count; i += stride) {
+                words[i] = words[i] + 1;
+            }
+            return count / stride * internal::getCacheLineSize();
+        }
+        case LOAD_DMA:
+            for(uint32_t offset = 0; offset + LOAD_DMA_SIZE <= LOAD_BUFFER_SIZE; offset += LOAD_DMA_SIZE) {
+                lt.dma->copy(lt.dmaDest, lt.buffer + offset, LOAD_DMA_SIZE);
+            }
+            return LOAD_BUFFER_SIZE / LOAD_DMA_SIZE * LOAD_DMA_SIZE;
+        default:
+            return 0;
+    }
+}
+
+static void IRAM_ATTR Load_Run(void* arg) {
+    LoadTask& lt = *(LoadTask*)arg;
+
+    uint32_t tlast = esp_cpu_get_cycle_count();
+    uint32_t tyield = tlast;
+    while(!lt.quit) {
+        lt.bytes += Load_Pass(lt);
+        const uint32_t tnow = esp_cpu_get_cycle_count();
+        lt.cycles += tnow - tlast;
+        tlast = tnow;
+        if(tnow - tyield >= LOAD_YIELD_CYCLES) {
+            vTaskDelay(1);
+            tlast = tyield = esp_cpu_get_cycle_count();
+        }
+    }
+
+    // lt may go away as soon as this is given.
+    xSemaphoreGive(lt.done);
+    vTaskDelete(nullptr);
+}
+
+
+/// @brief Allocates the load's buffers and starts it on the other core
+static bool Load_Start(LoadTask& lt, ContentionLoad load, DmaService& dma) {
+    lt = {};
+    lt.load = load;
+    if(load == LOAD_NONE) {
+        return true;
+    }
+
+    const uint32_t align = internal::getCacheLineSize();
+    lt.buffer = (uint8_t*)heap_caps_aligned_alloc(align, LOAD_BUFFER_SIZE, MALLOC_CAP_SPIRAM);
+    if(load == LOAD_DMA) {
+        lt.dmaDest = (uint8_t*)heap_caps_aligned_alloc(align, LOAD_DMA_SIZE, MALLOC_CAP_SPIRAM);
+        lt.dma = &dma;
+    }
+    lt.done = xSemaphoreCreateBinary();
+    if(!lt.buffer || (load == LOAD_DMA && !lt.dmaDest) || !lt.done) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        free(lt.buffer);
+        free(lt.dmaDest);
+        if(lt.done) {
+            vSemaphoreDelete(lt.done);
+        }
+        return false;
+    }
+    Initialize_Buffer(lt.buffer, LOAD_BUFFER_SIZE);
+
+    const BaseType_t core = (xPortGetCoreID() + 1) % portNUM_PROCESSORS;
+    if(xTaskCreatePinnedToCore(&Load_Run, "load", 4096, &lt, uxTaskPriorityGet(nullptr), &lt.task, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create the %s task", Load_Name(load));
+        free(lt.buffer);
+        free(lt.dmaDest);
+        vSemaphoreDelete(lt.done);
+        return false;
+    }
+    return true;
+}
+
+/// @brief Stops the load, waiting for it to finish its current pass, and frees its buffers
+static void Load_Stop(LoadTask& lt) {
+    if(lt.load == LOAD_NONE) {
+        return;
+    }
+    lt.quit = true;
+    xSemaphoreTake(lt.done, portMAX_DELAY);
+    vSemaphoreDelete(lt.done);
+    free(lt.buffer);
+    free(lt.dmaDest);
+}
+
+
+/// @brief Reruns every method on every region pair under each of the background \p loads
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+/// @param loads The ContentionLoad flags to run, one at a time
+void MemoryCopy_Contention(uint32_t size, uint32_t align, const RunnerConfig& config, uint32_t loads)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nCopy under load on the other core, %" PRIu32 "kb\n", size/1024);
+
+    // The DMA load gets its own driver, so it doesn't queue behind (or ahead of) the async_memcpy method
+    DmaService dma;
+    if((loads & LOAD_DMA) && dma.start({ .depth = 2, .psramAlign = internal::getCacheLineSize() }) != ESP_OK) {
+        loads &= ~LOAD_DMA;
+    }
+
+    static const ContentionLoad passes[] = { LOAD_NONE, LOAD_PSRAM_READ, LOAD_PSRAM_WRITE, LOAD_CACHE_THRASH, LOAD_DMA };
+    const size_t passCount = sizeof(passes) / sizeof(passes[0]);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        vector<CycleStats> idle(copyMethodCount);
+        vector<bool> valid(copyMethodCount);
+
+        for (size_t l = 0; l < passCount; l++) {
+            const ContentionLoad load = passes[l];
+            if (load != LOAD_NONE && !(loads & load))
+                continue;
+
+            LoadTask lt;
+            if (!Load_Start(lt, load, dma))
+                continue;
+
+            vector<CycleStats> results(copyMethodCount);
+            for (size_t m = 0; m < copyMethodCount; m++) {
+                if (!Run_Method(copyMethods[m], dest, source, size, useCache, config, results[m])) {
+                    valid[m] = false;
+                    continue;
+                }
+                if (load == LOAD_NONE) {
+                    idle[m] = results[m];
+                    valid[m] = true;
+                }
+            }
+
+            Load_Stop(lt);
+
+            ESP_LOGI(TAG, "%s, %s:", pair.desc, Load_Name(load));
+            if (load != LOAD_NONE && lt.cycles > 0) {
+                ESP_LOGI(TAG, "  load ran at %.2f MB/s", Load_MBps(lt.cycles, lt.bytes));
+            }
+            for (size_t m = 0; m < copyMethodCount; m++) {
+                if (!valid[m])
+                    continue;
+                const float mbps = Calc_MBps(results[m].median, size);
+                if (load == LOAD_NONE) {
+                    ESP_LOGI(TAG, "  %s%.2f MB/s, p99 %" PRIu32 " cycles", copyMethods[m].name, mbps, results[m].p99);
+                } else {
+                    const float idleMbps = Calc_MBps(idle[m].median, size);
+                    ESP_LOGI(TAG, "  %s%.2f MB/s (%+.1f%%), p99 %" PRIu32 " cycles (%+.1f%%)",
+                             copyMethods[m].name, mbps, 100.0f * (mbps - idleMbps) / idleMbps,
+                             results[m].p99, 100.0f * ((float)results[m].p99 - idle[m].p99) / idle[m].p99);
+                }
+            }
+            printf("\n");
+
+            // Give the log output some time to finish before the next load is started.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+    dma.stop();
+
+}
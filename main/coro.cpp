@@ -0,0 +1,152 @@
+/*
+* Coroutine test: DMA tiles out of PSRAM and checksums them, once as blocking
+* copy_dma() calls followed by the checksum, and once as coroutines on a
+* FreeRTOS executor, each copying its own tile while the others checksum.
+*
+* The coroutine version is the same sequential loop as the blocking one; the
+* executor is what lets the copies and the checksums overlap. Also reports the
+* heap taken by each coroutine frame, which is all a waiting coroutine costs.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/compare.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/coro.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Coroutines";
+
+/// @brief Bytes per DMA transfer
+static const uint32_t TILE = 4 * 1024;
+
+/// @brief Coroutines, each with its own tile
+static const uint32_t WORKERS = 4;
+
+
+/// @brief Copies every WORKERS'th tile of \p source, starting at \p first, into \p tile and adds up their checksums
+static Task Checksum_Worker(Executor& executor, uint8_t* tile, const uint8_t* source, uint32_t size, uint32_t first,
+                            uint64_t& sum, esp_err_t& result)
+{
+    for (uint32_t offset = first * TILE; offset < size; offset += WORKERS * TILE) {
+        result = co_await copyAsync(executor, tile, source + offset, TILE);
+        if (result != ESP_OK)
+            co_return result;
+        sum += checksum(tile, TILE);
+    }
+    co_return ESP_OK;
+}
+
+
+/// @brief Checksums \p size bytes of PSRAM tile by tile, blocking on each DMA copy and with coroutines
+/// @param size The size of the memory to checksum, a multiple of WORKERS * 4KB
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Coro(uint32_t size, uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nDMA and checksum of %" PRIu32 "kb in %" PRIu32 "kb tiles, blocking and with %" PRIu32 " coroutines\n",
+             size/1024, TILE/1024, WORKERS);
+
+    // The PSRAM source from the pool. The workers' tiles are one IRAM block of another size, allocated once.
+    Buffers_Start(size, 0, 1);
+    uint8_t* source = (uint8_t*)Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
+    uint8_t* tiles = (uint8_t*)heap_caps_aligned_alloc(align, WORKERS * TILE, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if(!source || !tiles) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffer_Release(source);
+        free(tiles);
+        Buffers_Stop();
+        return;
+    }
+    Initialize_Buffer(source, size);
+
+    // Blocking: one copy, then its checksum
+    uint64_t blockingSum = 0;
+    esp_err_t r = ESP_OK;
+    uint32_t tstart = esp_cpu_get_cycle_count();
+    for (uint32_t offset = 0; offset < size && r == ESP_OK; offset += TILE) {
+        r = copy_dma(tiles, source + offset, TILE);
+        blockingSum += checksum(tiles, TILE);
+    }
+    uint32_t tstop = esp_cpu_get_cycle_count();
+    if (r != ESP_OK) {
+        ESP_LOGE(TAG, "copy_dma failed: %s", esp_err_to_name(r));
+    } else {
+        Display_Performance("blocking copy_dma + checksum ", "PSRAM->IRAM", tstart, tstop, size);
+    }
+    const uint32_t blockingCycles = tstop - tstart;
+    vTaskDelay(50/portTICK_PERIOD_MS);
+
+    // Coroutines: the same loop, suspended while their copy is in flight
+    FreeRtosExecutor executor;
+    if (executor.start(WORKERS) == ESP_OK) {
+        uint64_t sums[WORKERS] = {};
+        // Until a worker's first copy, so one that never ran doesn't pass as done
+        esp_err_t results[WORKERS];
+        for (esp_err_t& result : results)
+            result = ESP_ERR_INVALID_STATE;
+
+        // Creating the coroutines allocates their frames, measured here outside the timed run.
+        // They don't start until spawned.
+        std::vector<Task> workers;
+        workers.reserve(WORKERS);
+        const size_t heapBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        for (uint32_t w = 0; w < WORKERS; w++)
+            workers.push_back(Checksum_Worker(executor, tiles + w * TILE, source, size, w, sums[w], results[w]));
+        const size_t frames = heapBefore - heap_caps_get_free_size(MALLOC_CAP_8BIT);
+
+        esp_err_t spawned = ESP_OK;
+        tstart = esp_cpu_get_cycle_count();
+        for (Task& worker : workers) {
+            const esp_err_t e = executor.spawn(std::move(worker));
+            if (e != ESP_OK)
+                spawned = e;
+        }
+        executor.run();
+        tstop = esp_cpu_get_cycle_count();
+        // Frees the frames of any worker that couldn't be spawned
+        workers.clear();
+
+        uint64_t coroSum = 0;
+        r = spawned;
+        if (r != ESP_OK)
+            ESP_LOGE(TAG, "spawning a coroutine failed: %s", esp_err_to_name(r));
+        for (uint32_t w = 0; w < WORKERS; w++) {
+            coroSum += sums[w];
+            if (results[w] != ESP_OK)
+                r = results[w];
+        }
+
+        if (r != ESP_OK) {
+            ESP_LOGE(TAG, "coroutine copy failed: %s", esp_err_to_name(r));
+        } else if (coroSum != blockingSum) {
+            ESP_LOGE(TAG, "coroutine checksums don't match the blocking ones!");
+        } else {
+            Display_Performance("coroutines copyAsync + checksum ", "PSRAM->IRAM", tstart, tstop, size);
+            ESP_LOGI(TAG, "%u bytes of heap per coroutine frame, %.1f%% of the blocking time",
+                     (unsigned)(frames / WORKERS), 100.0f * (tstop - tstart) / blockingCycles);
+        }
+        executor.stop();
+    }
+    printf("\n");
+
+    Buffer_Release(source);
+    free(tiles);
+    Buffers_Stop();
+
+}
@@ -0,0 +1,185 @@
+/*
+* DMA service test: separates the async_memcpy costs that the single-size test
+* either excludes or lumps together.
+*
+* + per-call: install, copy and uninstall for every transfer, as CopyBuffer_DMA does
+* + setup: installing the persistent service once
+* + submission latency: time spent in submit() before the CPU is free again
+* + steady state: throughput with the queue kept full of back-to-back requests
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/dma_service.hpp"
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "DMA Service";
+
+/// @brief Number of single transfers averaged for the latency figures
+static const uint32_t SINGLE_RUNS = 10;
+
+
+/// @brief Gets the source out of and the destination into a state where the DMA and the CPU agree
+static void Prepare_DMA(void* dest, void* source, uint32_t size) {
+    clearBuffer(dest, size);
+    if(isExtMem(source)) {
+        flushCache(source, size);
+    }
+}
+
+/// @brief Checks the DMA'd data, invalidating any stale destination cache lines first
+static bool Check_DMA(void* dest, void* source, uint32_t size, const char* what, const char* desc) {
+    if(isExtMem(dest)) {
+        invalidateCache(dest, size);
+    }
+    if(!fastcopy::equal(source, dest, size)) {
+        ESP_LOGE(TAG, "%s %s failed because the buffers don't match!", what, desc);
+        return false;
+    }
+    return true;
+}
+
+
+/// @brief Installs the driver, copies and uninstalls, timing each step
+static void Run_PerCall(void* dest, void* source, uint32_t size, const DmaServiceConfig& cfg, const char* desc)
+{
+    Prepare_DMA(dest, source, size);
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    DmaService service;
+    if(service.start(cfg) != ESP_OK) {
+        return;
+    }
+    const uint32_t tinstalled = esp_cpu_get_cycle_count();
+
+    uint32_t tdone = 0;
+    if(service.submit(dest, source, size, task) == ESP_OK) {
+        tdone = DmaService::waitNotified();
+    }
+    service.stop();
+    const uint32_t tstop = esp_cpu_get_cycle_count();
+
+    if(Check_DMA(dest, source, size, "per-call", desc)) {
+        ESP_LOGI(TAG, "per-call %s: install %" PRIu32 ", copy %" PRIu32 ", uninstall %" PRIu32 " cycles, total %s",
+                 desc, tinstalled - tstart, tdone - tinstalled, tstop - tdone,
+                 Calc_Bandwidth(tstart, tstop, size).c_str());
+    }
+}
+
+
+/// @brief Times single whole-buffer transfers on a service that is already running
+static void Run_Single(DmaService& service, void* dest, void* source, uint32_t size, const char* desc)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    uint64_t total = 0;
+    bool ok = true;
+
+    service.resetStats();
+    for(uint32_t run = 0; run < SINGLE_RUNS; run++) {
+        Prepare_DMA(dest, source, size);
+        const uint32_t tstart = esp_cpu_get_cycle_count();
+        uint32_t tstop = tstart;
+        if(service.submit(dest, source, size, task) == ESP_OK) {
+            tstop = DmaService::waitNotified();
+        }
+        total += tstop - tstart;
+        ok &= Check_DMA(dest, source, size, "single", desc);
+    }
+
+    if(ok) {
+        const DmaServiceStats stats = service.stats();
+        const uint32_t average = total / SINGLE_RUNS;
+        ESP_LOGI(TAG, "single %s: submit %" PRIu32 " (max %" PRIu32 ") cycles, copy %" PRIu32 " cycles = %.2f MB/s",
+                 desc, (uint32_t)(stats.submitCycles / stats.submitted), stats.maxSubmitCycles,
+                 average, Calc_MBps(average, size));
+    }
+}
+
+
+/// @brief Splits the buffer into \p chunk sized requests, submits them back to back and measures throughput
+static void Run_Streaming(DmaService& service, void* dest, void* source, uint32_t size, uint32_t chunk, const char* desc)
+{
+    Prepare_DMA(dest, source, size);
+
+    service.resetStats();
+    for(uint32_t offset = 0; offset < size; offset += chunk) {
+        const uint32_t len = (size - offset) < chunk ? (size - offset) : chunk;
+        service.submit((uint8_t*)dest + offset, (uint8_t*)source + offset, len, nullptr, nullptr);
+    }
+    service.waitIdle();
+
+    if(Check_DMA(dest, source, size, "steady state", desc)) {
+        const DmaServiceStats stats = service.stats();
+        ESP_LOGI(TAG, "steady state %s, %" PRIu32 " x %" PRIu32 " bytes: submit %" PRIu32 " (max %" PRIu32 ") cycles, latency %" PRIu32 " cycles, %.2f MB/s",
+                 desc, stats.completed, chunk,
+                 (uint32_t)(stats.submitCycles / stats.submitted), stats.maxSubmitCycles,
+                 (uint32_t)(stats.latencyCycles / stats.completed),
+                 Calc_MBps((uint32_t)stats.busyCycles, (uint32_t)stats.bytes));
+    }
+}
+
+
+/// @brief Compares per-call driver installs with the persistent DMA service
+/// @param size The size of the memory to copy
+/// @param chunk The request size used for the steady state throughput
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_DmaService(uint32_t size, uint32_t chunk, uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nDMA service, %" PRIu32 "kb, %" PRIu32 " byte requests\n", size/1024, chunk);
+
+    const DmaServiceConfig cfg = { .depth = 8, .psramAlign = align };
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        Run_PerCall(dest, source, size, cfg, pair.desc);
+
+        DmaService service;
+        if(service.start(cfg) == ESP_OK) {
+            ESP_LOGI(TAG, "setup %s: %" PRIu32 " cycles", pair.desc, service.stats().setupCycles);
+            Run_Single(service, dest, source, size, pair.desc);
+            Run_Streaming(service, dest, source, size, chunk, pair.desc);
+            service.stop();
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+
+        // Give the log output some time to finish before the next region pair.
+        vTaskDelay(50/portTICK_PERIOD_MS);
+    }
+
+    Buffers_Stop();
+
+}
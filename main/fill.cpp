@@ -0,0 +1,181 @@
+/*
+* Fill test: memset, a 32-bit for loop, the PIE fill, DSP AES3 memset and
+* fast_memset on IRAM and PSRAM, zeroing and filling with a pattern.
+*
+* The destination is prepared and flushed exactly as in the copy tests, so a
+* fill to PSRAM only counts as done once it has been written back.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "dsps_mem.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy.h"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/compare.hpp"
+#include "fastcopy/kernels.hpp"
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace fastcopy;
+
+static const char *TAG = "Fill";
+
+/// @brief A fill kernel under test. Sets \p size bytes at \p dest to \p value.
+typedef void (*FillKernel)(void* dest, uint8_t value, size_t size);
+
+struct FillMethod {
+    const char* name;
+    FillKernel kernel;
+};
+
+/// @brief A single memory region to fill
+struct Region {
+    const char* desc;
+    uint32_t caps;
+};
+
+
+static IRAM_ATTR void fill_memset(void* dest, uint8_t value, size_t size) {
+    memset(dest, value, size);
+}
+
+static IRAM_ATTR void fill_forloop(void* dest, uint8_t value, size_t size) {
+    const uint32_t pattern = value * 0x01010101u;
+    uint32_t* pDest = (uint32_t*)dest;
+    for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+        pDest[i] = pattern;
+    }
+}
+
+static IRAM_ATTR void fill_dsp(void* dest, uint8_t value, size_t size) {
+    dsps_memset_aes3(dest, value, size);
+}
+
+static IRAM_ATTR void fill_fast_memset(void* dest, uint8_t value, size_t size) {
+    fast_memset(dest, value, size);
+}
+
+
+static const FillMethod fillMethods[] = {
+    { "memset ",               &fill_memset      },
+    { "32-bit for loop fill ", &fill_forloop     },
+    { "PIE 128-bit fill ",     &fill_pie         },
+    { "DSP AES3 memset ",      &fill_dsp         },
+    { "fast_memset ",          &fill_fast_memset },
+};
+
+static const Region regions[] = {
+    { "IRAM",  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA },
+    { "PSRAM", MALLOC_CAP_SPIRAM },
+};
+
+/// @brief Zeroing, and a pattern to show the kernels don't rely on the value being 0
+static const uint8_t values[] = { 0x00, 0xA5 };
+
+
+/// @brief Runs \p kernel once with the same cache preparation and flushing as Time_Copy
+static IRAM_ATTR uint32_t Time_Fill(FillKernel kernel, void* dest, uint8_t value, size_t size, bool useCache)
+{
+
+    // Start from the opposite value so an untouched byte is always caught
+    memset(dest, (uint8_t)~value, size);
+    bool needFlush = false;
+    if (isExtMem(dest)) {
+        flushCache(dest, size);
+        if (useCache) {
+            needFlush = uncacheForWrite(dest, size);
+        }
+    }
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    kernel(dest, value, size);
+
+    if (needFlush) {
+        compiler_mem_barrier(dest,size);
+        flushCache(dest, size);
+    }
+
+    return esp_cpu_get_cycle_count() - tstart;
+
+}
+
+
+/// @brief Bytes of \p dest compared against the reference tile at a time
+static const size_t CHECK_TILE = 1024;
+
+/// @brief Checks every byte of \p dest is \p value, with equal() against a tile of \p value
+static bool Check_Fill(const void* dest, uint8_t value, size_t size) {
+    // 16-byte aligned like the buffers, so equal() can take its PIE path
+    alignas(16) static uint8_t reference[CHECK_TILE];
+    memset(reference, value, sizeof(reference));
+
+    const uint8_t* p = (const uint8_t*)dest;
+    for (size_t offset = 0; offset < size; offset += CHECK_TILE) {
+        const size_t chunk = size - offset < CHECK_TILE ? size - offset : CHECK_TILE;
+        if (!equal(p + offset, reference, chunk))
+            return false;
+    }
+    return true;
+}
+
+
+/// @brief Fills IRAM and PSRAM buffers with every fill method
+/// @param size The size of the memory to fill
+/// @param align The alignment size to use when allocating the memory
+void MemoryFill(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nfill test, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size, 1, 1);
+
+    for (const Region& region : regions) {
+        void* dest = Buffer_Acquire(align, size, region.caps);
+        if (!dest) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            break;
+        }
+
+        for (uint8_t value : values) {
+            char desc[32];
+            snprintf(desc, sizeof(desc), "%s with 0x%02x", region.desc, value);
+
+            for (const FillMethod& method : fillMethods) {
+                const uint32_t cycles = Time_Fill(method.kernel, dest, value, size, useCache);
+                if (Check_Fill(dest, value, size))
+                    Display_Performance(method.name, desc, 0, cycles, size);
+                else
+                    ESP_LOGE(TAG, "%s%s failed because the buffer doesn't match!", method.name, desc);
+
+                // Give the log output some time to finish before the next test is run.
+                vTaskDelay(50/portTICK_PERIOD_MS);
+            }
+            printf("\n");
+        }
+
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
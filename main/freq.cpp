@@ -0,0 +1,168 @@
+/*
+* Frequency test: the statistical runner over every method and region pair at
+* 80, 160 and 240 MHz, with the CPU clock pinned by a power management lock.
+*
+* Reports MB/s and bytes per CPU cycle at each clock. A method that keeps its
+* MB/s at 80 MHz is bound by the memory, usually PSRAM, and loses nothing by
+* running at the lower clock; one that keeps its bytes per cycle instead is
+* bound by the CPU. The PSRAM clock doesn't depend on the CPU clock.
+*
+* Needs power management (CONFIG_PM_ENABLE) in menuconfig. The configuration
+* in place before the sweep is restored afterwards.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_clk_tree.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "benchmark.h"
+
+using namespace std;
+
+static const char *TAG = "Frequency";
+
+/// @brief CPU clocks to run at, in MHz. The first and last are compared in the summary.
+static const uint32_t frequencies[] = { 80, 160, 240 };
+static const size_t FREQ_COUNT = sizeof(frequencies) / sizeof(frequencies[0]);
+
+/// @brief A method that keeps at least this much of its bandwidth at the lowest clock counts as memory-bound
+static const float MEMORY_BOUND = 0.9f;
+
+
+#if CONFIG_PM_ENABLE
+
+/// @brief Limits the CPU to \p mhz and takes \p lock so it runs at exactly that
+static bool Set_Frequency(esp_pm_lock_handle_t lock, uint32_t mhz)
+{
+    const esp_pm_config_t cfg = { .max_freq_mhz = (int)mhz, .min_freq_mhz = (int)mhz, .light_sleep_enable = false };
+    esp_err_t r = esp_pm_configure(&cfg);
+    if (r == ESP_OK)
+        r = esp_pm_lock_acquire(lock);
+    if (r != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to switch to %" PRIu32 " MHz: %s", mhz, esp_err_to_name(r));
+        return false;
+    }
+
+    uint32_t hz = 0;
+    esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_CPU, ESP_CLK_TREE_SRC_FREQ_PRECISION_EXACT, &hz);
+    if (hz / 1000000 != mhz)
+        ESP_LOGW(TAG, "Asked for %" PRIu32 " MHz, the CPU runs at %" PRIu32 " MHz", mhz, hz / 1000000);
+    return true;
+}
+
+#endif
+
+
+/// @brief Runs every method on every region pair at each CPU clock in frequencies[]
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+void MemoryCopy_Frequency(uint32_t size, uint32_t align, const RunnerConfig& config)
+{
+
+#if !CONFIG_PM_ENABLE
+    (void)size;
+    (void)align;
+    (void)config;
+    ESP_LOGE(TAG, "The frequency sweep needs power management: enable CONFIG_PM_ENABLE in menuconfig");
+#else
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nCPU frequency sweep, %" PRIu32 "kb\n", size/1024);
+
+    esp_pm_config_t original = {};
+    if (esp_pm_get_configuration(&original) != ESP_OK || original.max_freq_mhz == 0) {
+        original = { .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, .min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, .light_sleep_enable = false };
+    }
+
+    esp_pm_lock_handle_t lock = nullptr;
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "freq sweep", &lock) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the power management lock");
+        return;
+    }
+
+    // MB/s per clock, region pair and method; 0 where a method didn't run
+    vector<float> results(FREQ_COUNT * regionPairCount * copyMethodCount, 0.0f);
+    auto result = [&](size_t f, size_t p, size_t m) -> float& {
+        return results[(f * regionPairCount + p) * copyMethodCount + m];
+    };
+
+    Buffers_Start(size);
+
+    for (size_t f = 0; f < FREQ_COUNT; f++) {
+        if (!Set_Frequency(lock, frequencies[f]))
+            continue;
+
+        printf("\nMHz,method,region,median cycles,MB/s,bytes/cycle\n");
+        for (size_t p = 0; p < regionPairCount; p++) {
+            const RegionPair& pair = regionPairs[p];
+
+            void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+            void* dest = Buffer_Acquire(align, size, pair.destCaps);
+            if(!dest || !source) {
+                ESP_LOGE(TAG, "Memory Allocation failed");
+                Buffer_Release(source);
+                Buffer_Release(dest);
+                break;
+            }
+            Initialize_Buffer(source, size);
+
+            for (size_t m = 0; m < copyMethodCount; m++) {
+                const CopyMethod& method = copyMethods[m];
+                CycleStats stats;
+                if (!Run_Method(method, dest, source, size, useCache, config, stats))
+                    continue;
+
+                result(f, p, m) = Calc_MBps(stats.median, size);
+                printf("%" PRIu32 ",%s,%s,%" PRIu32 ",%.2f,%.3f\n", frequencies[f], Method_Label(method).c_str(), pair.desc,
+                       stats.median, result(f, p, m), (float)size / stats.median);
+
+                // Give the log output some time to finish before the next test is run.
+                vTaskDelay(10/portTICK_PERIOD_MS);
+            }
+
+            Buffer_Release(source);
+            Buffer_Release(dest);
+        }
+
+        esp_pm_lock_release(lock);
+    }
+
+    Buffers_Stop();
+
+    esp_pm_configure(&original);
+    esp_pm_lock_delete(lock);
+
+    // Which methods keep their bandwidth at the lowest clock
+    printf("\n");
+    const size_t low = 0, high = FREQ_COUNT - 1;
+    for (size_t p = 0; p < regionPairCount; p++) {
+        for (size_t m = 0; m < copyMethodCount; m++) {
+            const float lowMbps = result(low, p, m);
+            const float highMbps = result(high, p, m);
+            if (lowMbps == 0 || highMbps == 0)
+                continue;
+            const float kept = lowMbps / highMbps;
+            ESP_LOGI(TAG, "%s%s keeps %.0f%% of its %" PRIu32 " MHz bandwidth at %" PRIu32 " MHz: %s",
+                     copyMethods[m].name, regionPairs[p].desc, 100.0f * kept, frequencies[high], frequencies[low],
+                     kept >= MEMORY_BOUND ? "memory-bound" : "CPU-bound");
+        }
+    }
+
+#endif
+
+}
@@ -0,0 +1,91 @@
+/*
+* Hybrid copy test: splits each copy between the GDMA and the CPU so both move
+* data at the same time.
+*
+* For every region pair the DMA share is calibrated from CPU only to DMA only,
+* the curve is printed, and the best share is then run and checked next to
+* memcpy and async_memcpy on their own.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/hybrid.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Hybrid";
+
+static const char* const methodNames[] = {
+    "memcpy",
+    "async_memcpy",
+    "Hybrid DMA+CPU",
+};
+
+
+/// @brief Calibrates the hybrid copy's DMA share for every region pair and checks the result
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Hybrid(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nhybrid DMA+CPU copy, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        uint32_t cycles[HYBRID_CALIBRATION_POINTS];
+        const uint32_t best = hybrid_calibrate(dest, source, size, cycles);
+
+        printf("%s DMA share,cycles,MB/s\n", pair.desc);
+        for (uint32_t i = 0; i < HYBRID_CALIBRATION_POINTS; i++) {
+            const uint32_t share = i * HYBRID_SHARE_MAX / (HYBRID_CALIBRATION_POINTS - 1);
+            printf("%.1f%%,%" PRIu32 ",%.2f\n", 100.0f * share / HYBRID_SHARE_MAX, cycles[i], Calc_MBps(cycles[i], size));
+        }
+        ESP_LOGI(TAG, "%s best DMA share %.1f%%", pair.desc, 100.0f * best / HYBRID_SHARE_MAX);
+
+        for (const char* name : methodNames) {
+            const CopyMethod* method = Find_Method(name);
+            if (!method || !Method_Supports(*method, dest, source, size))
+                continue;
+
+            clearBuffer(dest, size);
+            const uint32_t t = Time_Copy(*method, dest, source, size, useCache);
+            Display_Results(method->name, pair.desc, 0, t, dest, source, size);
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
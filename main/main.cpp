@@ -32,253 +32,20 @@
 #include "hal/cache_hal.h"
 #include "dsps_mem.h"
 
-#include "esp_cache.h"
-#include "hal/mmu_hal.h"
-#include "rom/cache.h"
+#include "fastcopy.h"
+#include "fastcopy/pie.hpp"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
 
 using namespace std;
+using namespace fastcopy;
 
 static const char *TAG = "Memory Copy";
 
 
-// Uncomment to use the PSRAM cache
-#define USE_CACHE 
-
-
-#define INL __attribute__((always_inline))
-
-/**
- * @brief Uses Xtensa's zero-overhead loop to execute a given operation a number of times.
- * This function does \e not save/restore the LOOP registers, so if required these need to be 
- * saved&restored explicitly around the function call.
- * @note This may fail to assemble when compiled with \c -Og or less
- * 
- * @tparam F Type of the functor to execute
- * @tparam Args Argument types of the functor
- * @param cnt Number of iterations
- * @param f The functor to invoke
- * @param args Arguments to pass to the functor
- */
-template<typename F, typename...Args>
-static IRAM_ATTR inline void INL rpt(const uint32_t cnt, const F& f, Args&&...args) {
-
-    bgn:
-        asm goto (
-            "LOOPNEZ %[cnt], %l[end]"
-            : /* no output*/
-            : [cnt] "r" (cnt)
-            : /* no clobbers */
-            : end
-        );
-
-            f(std::forward<Args>(args)...);
-
- 
-    end:
-        /* Tell the compiler that the above code might execute more than once.
-           The begin label must be before the inital LOOP asm because otherwise
-           gcc may decide to put one-off setup code between the LOOP asm and the
-           begin label, i.e. inside the loop.
-        */
-        asm goto ("":::: bgn);    
-        ;
-}
-
-/*
-    q<R> = *(src & ~0xf);
-    src += INC;
-*/
-template<uint8_t R, int16_t INC = 16, typename S>
-requires ( R <= 7 && ((INC & 0xf) == 0) && (-2048 <= INC) && (INC <= 2032) )
-static IRAM_ATTR inline void INL vld_128_ip(S*& src) {
-    asm volatile (
-        "EE.VLD.128.IP q%[reg], %[src], %[inc]"
-        : [src] "+r" (src)
-        : [reg] "i" (R),
-          [inc] "i" (INC),
-          "m" (*(const uint8_t(*)[16])src)
-        : 
-    );
-}
-
-/*
-    *(dest & ~0xf) = q<R>;
-    dest += INC;
-*/
-template<uint8_t R, int16_t INC = 16, typename D>
-requires ( R <= 7 && ((INC & 0xf) == 0) && (-2048 <= INC) && (INC <= 2032) && !std::is_const_v<D> )
-static IRAM_ATTR inline void INL vst_128_ip(D*& dest) {
-    asm volatile (
-        "EE.VST.128.IP q%[reg], %[dest], %[inc]"
-        : [dest] "+r" (dest),
-          "=m" (*(uint8_t(*)[16])dest)
-        : [reg] "i" (R),
-          [inc] "i" (INC)
-        : 
-    );
-}
-
-namespace internal {
-
-    static uint16_t cacheLineSize;
-
-    // Cache control directly via functions provided in ROM.
-    // Don't try this at home! Always use the public APIs prescribed by Espressif.
-
-    static void fetchCacheLineSize() {
-        struct cache_mode cm;
-        cm.icache = 0; // data cache
-        Cache_Get_Mode(&cm);
-        cacheLineSize = cm.cache_line_size;
-    }
-
-    static uint32_t getCacheLineSize() {
-        if(cacheLineSize == 0) [[unlikely]] {
-            fetchCacheLineSize();
-        }
-        return cacheLineSize;
-    }
-
-    template<auto OP>
-    static void onRange(void* addr, size_t size) {
-        const uint32_t ls = getCacheLineSize();
-        const uint32_t off = ((uint32_t)addr) & (ls-1);
-        const uint32_t start = ((uint32_t)addr - off);        
-        const uint32_t lines = (size + off + (ls-1)) / ls;
-        OP(start,lines);
-    }
-
-    static void writeBack(void* addr, size_t size) {
-        onRange<Cache_WriteBack_Items>(addr,size);
-    }
-
-    static void invalidate(void* addr, size_t size) {
-        onRange<Cache_Invalidate_DCache_Items>(addr,size);
-    }
-
-    static void invalidateCache() {
-        Cache_Invalidate_DCache_All();
-    }
-
-    static void clean(void* addr, size_t size) {
-        onRange<Cache_Clean_Items>(addr,size);
-    }
-
-    static void cleanCache() {
-        Cache_Clean_All();
-    }
-}
-
-/**
- * @brief Flush and invalidate a memory region from the cache.
- * 
- * @param addr 
- * @param size 
- * @return true 
- * @return false 
- */
-static inline bool flushCache(void* const addr, const size_t size) {
-    return esp_cache_msync(addr,size,ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_TYPE_DATA) == ESP_OK;
-    // internal::writeBack(addr,size);
-    // return true;
-}
-
-/**
- * @brief Invalidate a memory region from the cache.
- * 
- * @param addr 
- * @param size 
- * @return true 
- * @return false 
- */
-static inline bool invalidateCache(void* const addr, const size_t size) {
-    return esp_cache_msync(addr,size,ESP_CACHE_MSYNC_FLAG_DIR_M2C | ESP_CACHE_MSYNC_FLAG_TYPE_DATA) == ESP_OK;
-    // internal::invalidate(addr,size);
-    // return true;
-}
-
-static inline void invalidateCache() {
-    internal::invalidateCache();
-}
-
-/**
- * @brief Remove data to be overwritte from the cache.
- * 
- * @param addr 
- * @param size 
- * @return true 
- * @return false 
- */
-static inline bool uncacheForWrite(void* const addr, const size_t size) {
-    return invalidateCache(addr,size);
-    // internal::clean(addr,size);
-    return true;
-}
-
-static inline bool uncacheForWrite() {
-    internal::cleanCache();
-    return true;
-}
-
-/**
- * @brief Remove data to be read from the cache.
- * 
- * @param addr 
- * @param size 
- * @return true 
- * @return false 
- */
-static inline bool uncacheForRead(void* const addr, const size_t size) {
-    return flushCache(addr,size) && invalidateCache(addr,size);
-}
-
-static inline bool isExtMem(void* const addr) {
-    return mmu_hal_check_valid_ext_vaddr_region(0, (uint32_t)addr, 1, MMU_VADDR_DATA );
-}
-
-
-static inline void INL compiler_mem_barrier(void* const addr, const size_t size) {
-    /* Let the compiler know that
-        a) we need all data actually written to memory at addr before this point, and
-        b) it cannot make any assumptions about the memory content at addr after this point.
-    */
-    asm volatile("":"+m" (*(uint8_t(*)[size])addr));
-}
-
-
-/**
- * @brief Preps the cache for both \p dest and \p src by flushing & invalidating any cached data.
- * 
- * @param dest destination where data will be subsequently written to
- * @param src source where data will be subsequently read from
- * @param size size in bytes of the \p dest and \p src memory regions
- * @param useCache whether to use the cache. If \c false, this function does nothing
- * @return true \p dest \e is cached memory and was successfully invalidated from the cache
- * @return false \p dest is \e not cached memory
- */
-static inline bool prepareCache(void* const dest, void* const src, const size_t size, const bool useCache) 
-{
-
-    compiler_mem_barrier(src,size);
-
-    // Do nothing if we're not using the cache
-    if (! useCache)
-        return false;
-
-    if(isExtMem(src)) {
-        // ESP_LOGI(TAG, "SRC is ext.");
-        uncacheForRead(src,size);
-    }
-    if(isExtMem(dest)) {
-        // ESP_LOGI(TAG, "DEST is ext.");
-        return uncacheForWrite(dest,size);
-    } else {
-        return false;
-    }
-}
-
-
-
 /// @brief The source buffer
 void* _source;
 
@@ -288,7 +55,6 @@ void* _dest;
 
 // Function prototypes
 esp_err_t CopyBuffer(void* dest, void* source, uint32_t size, uint32_t align, bool useCache, const char *desc);
-void Initialize_Buffer(void *buffer, uint32_t size);
 
 
 /// @brief Async Memory copy callback implementation, running in ISR context
@@ -309,19 +75,32 @@ static IRAM_ATTR bool dmacpy_cb(async_memcpy_t hdl, async_memcpy_event_t*, void*
 /// @param size The size of the buffer in bytes
 void Initialize_Buffer(void *buffer, uint32_t size)
 {
-    uint32_t r = esp_random();
-    for (uint32_t i = 0; i < size; i++)
+    uint8_t r = esp_random();
+    uint32_t i = 0;
+
+    // Four bytes at a time when aligned: each byte of the word goes up by 4,
+    // masked so that a byte wrapping around doesn't carry into the next.
+    if (((uintptr_t)buffer & 3) == 0)
+    {
+        uint32_t w = (uint32_t)r | (uint32_t)(uint8_t)(r+1) << 8 | (uint32_t)(uint8_t)(r+2) << 16 | (uint32_t)(uint8_t)(r+3) << 24;
+        for (; i + 4 <= size; i += 4)
+        {
+            *(uint32_t *)((uint8_t *)buffer + i) = w;
+            w = ((w & 0x7f7f7f7f) + 0x04040404) ^ (w & 0x80808080);
+        }
+    }
+
+    for (; i < size; i++)
     {
         ((uint8_t *)buffer)[i] = i + r;
     }
 }
 
 
-/// @brief Calculates the bandwidth of a memory copy operation
-/// @param tstart time in CPU clock cycles when the copy started
-/// @param tstop time in CPU clock cycles when the copy finished
+/// @brief Calculates the bandwidth of a memory copy operation in MB/s
+/// @param cycles time in CPU clock cycles the copy took
 /// @param size size of the memory copies in bytes
-string Calc_Bandwidth(uint32_t tstart, uint32_t tstop, uint32_t size)
+float Calc_MBps(uint32_t cycles, uint32_t size)
 {
 
     uint32_t f_cpu = 240000000;
@@ -329,9 +108,20 @@ string Calc_Bandwidth(uint32_t tstart, uint32_t tstop, uint32_t size)
     if(esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_CPU,ESP_CLK_TREE_SRC_FREQ_PRECISION_CACHED, &f_cpu) != ESP_OK) {
         ESP_LOGW(TAG, "Failed to get CPU clock. Assuming %" PRIu32 " MHz.", f_cpu / 1000000);
     }
-    uint32_t cycles = tstop - tstart;
     float seconds = (float)cycles / f_cpu; // 240000000.0f;
-    float bandwidth = (float)size / (1024.0f * 1024.0f * seconds);
+    return (float)size / (1024.0f * 1024.0f * seconds);
+
+}
+
+
+/// @brief Calculates the bandwidth of a memory copy operation
+/// @param tstart time in CPU clock cycles when the copy started
+/// @param tstop time in CPU clock cycles when the copy finished
+/// @param size size of the memory copies in bytes
+string Calc_Bandwidth(uint32_t tstart, uint32_t tstop, uint32_t size)
+{
+
+    float bandwidth = Calc_MBps(tstop - tstart, size);
 
     // Return the bandwidth as a string
     char buffer[50];
@@ -368,12 +158,13 @@ void Display_Results(string prefix, string desc, uint32_t tstart, uint32_t tstop
 {
 
     // Compare the destination and source buffers
-    const bool match = memcmp(source,dest,size) == 0;
+    const bool match = fastcopy::equal(source,dest,size);
 
     // Display the performance if they match, or and error if they dont
-    if (match)
+    if (match) {
         Display_Performance(prefix, desc, tstart, tstop, size);
-    else
+        Perf_Report(prefix, desc, tstop - tstart);
+    } else
         ESP_LOGE(TAG, "%s%s failed because the buffers don't match!", prefix.c_str(), desc.c_str());
 
     // Give the log output some time to finish before the next test is run.
@@ -393,24 +184,18 @@ template<typename T>
 static IRAM_ATTR inline void CopyBuffer_ForLoop(void* dest, void* source, uint32_t size, string prefix, const char *desc, const bool useCache)
 {
     
-    // Attempt the copy using code with a 32 bit pointer
-    T* pSource = (T*)source;
-    T* pDest = (T*)dest;
-    int aCopies = size / sizeof(T);
-
 #ifdef USE_CACHE
     // Prepare the cache
     const bool needFlush = prepareCache(dest, source, size, useCache);
 #endif
 
     // Start our performance timer
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
 
     // Do the work - using a for loop
     // ==============================
-    for (int i = 0; i < aCopies; i++) {
-        pDest[i] = pSource[i];
-    }
+    copy_forloop<T>(dest, source, size);
 
     compiler_mem_barrier(dest,size);
 
@@ -423,6 +208,7 @@ static IRAM_ATTR inline void CopyBuffer_ForLoop(void* dest, void* source, uint32
 
     // Display the results
     const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
     Display_Results(prefix + "for loop copy ", desc, tstart, tstop, dest, source, size);
     
 }
@@ -443,6 +229,7 @@ IRAM_ATTR esp_err_t CopyBuffer_memcpy(void* dest, void* source, uint32_t size, c
 #endif
 
     // Start our performance timer
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
 
     // Do the work - using the memcpy function
@@ -461,6 +248,7 @@ IRAM_ATTR esp_err_t CopyBuffer_memcpy(void* dest, void* source, uint32_t size, c
 
     // Display the resuilts
     const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
     if (ret != 0) {
         Display_Results("memcpy ", desc, tstart, tstop, dest, source, size);
     } else {
@@ -507,11 +295,14 @@ IRAM_ATTR esp_err_t CopyBuffer_DMA(void* dest, void* source, uint32_t size, uint
     // Initiate a DMA copy
     ESP_LOGD(TAG, "Starting DMA copy.");
     TaskHandle_t task = xTaskGetCurrentTaskHandle();    
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
     r = esp_async_memcpy(handle, _dest, _source, size, &dmacpy_cb, (void*)task);
     if(r == ESP_OK) {
         uint32_t tstop; // We get the tstop value from the callback via the notification.
-        if(xTaskNotifyWait(0,0,&tstop,1000/portTICK_PERIOD_MS)) {
+        const BaseType_t done = xTaskNotifyWait(0,UINT32_MAX,&tstop,1000/portTICK_PERIOD_MS);
+        Perf_End();
+        if(done) {
             // Display the results
             Display_Results("async_memcpy ", desc, tstart, tstop, dest, source, size);
         } else {
@@ -537,13 +328,6 @@ IRAM_ATTR esp_err_t CopyBuffer_DMA(void* dest, void* source, uint32_t size, uint
 /// @return ESP_OK if successful. Otherwise ESP_FAIL
 IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_16bytes(void* dest, void* source, uint32_t size, const char *desc, const bool useCache)
 {
-    // Copy the source to dest using the ESP32-S3 PIE 128-bit memory copy instructions
-
-    // Setup the variables
-    const uint32_t bytes_per_iteration = 16;
-    const uint32_t cnt = size / bytes_per_iteration;
-    const void* src_p = source;
-    void* dest_p = dest;
 
 #ifdef USE_CACHE
     // Prepare the cache
@@ -551,26 +335,12 @@ IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_16bytes(void* dest, void* source, uint
 #endif
 
     // Start our performance timer
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
 
     // Do the work - using the ESP32-S3 PIE 128-bit load/store instructions moving 16 bytes per iteration
-
-    // Due to the extra latency of the load instruction, this code copies 16 bytes in (2+1) CPU clock cycles.
-    rpt(cnt, [&src_p,&dest_p]() {
-        vld_128_ip<0>(src_p); // Load 16 bytes from RAM into q0, increment src_p
-        vst_128_ip<0>(dest_p); // Store 16 bytes from q0 to RAM, increment dest_p
-    });
-
-    // Same as above:
-    // asm volatile (
-    //     "LOOPNEZ %[cnt], end_loop%=" "\n"
-    //     "   EE.VLD.128.IP q0, %[src_p], 16" "\n"
-    //     "   EE.VST.128.IP q0, %[dest_p], 16" "\n"
-    //     "end_loop%=:"
-    //     : [src_p] "+&r" (src_p), [dest_p] "+&r" (dest_p)
-    //     : [cnt] "r" (cnt)
-    //     : "memory"
-    // );
+    // ====================================================================================================
+    copy_pie_16(dest, source, size);
 
 #ifdef USE_CACHE
     // Flush the cache if needed
@@ -582,6 +352,7 @@ IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_16bytes(void* dest, void* source, uint
 
     // Display the resuilts
     const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
     Display_Results("PIE 128-bit (16 byte loop) ", desc, tstart, tstop, dest, source, size);
 
     return ESP_OK;
@@ -597,52 +368,18 @@ IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_16bytes(void* dest, void* source, uint
 IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_32bytes(void* dest, void* source, uint32_t size, const char *desc, const bool useCache)
 {
 
-    // Copy the source to dest using the ESP32-S3 PIE 128-bit load/store instructions
-
-
-    // Do the work
-    const uint32_t bytes_per_iteration = 32;
-    const uint32_t cnt = size / bytes_per_iteration;
-    const void* src_p = source;
-    void* dest_p = dest;
-
 #ifdef USE_CACHE
     // Prepare the cache
     const bool needFlush = prepareCache(dest, source, size, useCache);
 #endif
 
     // Start our performance timer
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
 
     // Do the work - using the ESP32-S3 PIE 128-bit load/store instructions moving 32 bytes per iteration
     // ====================================================================================================
-    /* Alternating access between two Q registers allows the pipeline to hide the latency
-       incurred from the data dependency of successive instructions.
-       Interestingly, the still-present data dependency on the _address_ register does
-       _not_ induce any pipeline stalls.
-
-       Thanks to the CPU pipeline, this code copies 32 bytes in 4 CPU clock cycles.
-    */
-    rpt(cnt, [&src_p,&dest_p]() {
-        vld_128_ip<0>(src_p); // Load 16 bytes from RAM into q0, increment src_p
-        vld_128_ip<1>(src_p); // Load 16 bytes from RAM into q1, increment src_p
-        vst_128_ip<0>(dest_p); // Store 16 bytes from q0 to RAM, increment dest_p
-        vst_128_ip<1>(dest_p); // Store 16 bytes from q1 to RAM, increment dest_p
-    });
-
-    // Same as above:
-    // asm volatile (
-    //     "LOOPNEZ %[cnt], end_loop%=" "\n"
-    //     "   EE.VLD.128.IP q0, %[src_p], 16" "\n"
-    //     "   EE.VLD.128.IP q1, %[src_p], 16" "\n"
-
-    //     "   EE.VST.128.IP q0, %[dest_p], 16" "\n"
-    //     "   EE.VST.128.IP q1, %[dest_p], 16" "\n"
-    //     "end_loop%=:"
-    //     : [src_p] "+&r" (src_p), [dest_p] "+&r" (dest_p)
-    //     : [cnt] "r" (cnt)
-    //     : "memory"
-    // );
+    copy_pie_32(dest, source, size);
 
 #ifdef USE_CACHE
     // Flush the cache if needed
@@ -654,6 +391,7 @@ IRAM_ATTR esp_err_t CopyBuffer_PIE_128bit_32bytes(void* dest, void* source, uint
 
     // Display the resuilts
     const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
     Display_Results("PIE 128-bit (32 byte loop) ", desc, tstart, tstop, dest, source, size);
 
     return ESP_OK;
@@ -676,6 +414,7 @@ IRAM_ATTR esp_err_t CopyBuffer_DSP(void* dest, void* source, uint32_t size, cons
 #endif
 
     // Start our performance timer
+    Perf_Begin();
     const uint32_t tstart = esp_cpu_get_cycle_count();
 
     // Do the work - using the ESP32-S3 dsp memory copy instructions
@@ -695,25 +434,79 @@ IRAM_ATTR esp_err_t CopyBuffer_DSP(void* dest, void* source, uint32_t size, cons
 
     // Display the resuilts
     const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
     Display_Results("DSP AES3 ", desc, tstart, tstop, dest, source, size);
 
     return ESP_OK;
 
 }
 
+/// @brief Copies a buffer using fast_memcpy from the fastcopy component, which picks a kernel itself
+/// @param dest pointer to the buffer to copy to
+/// @param source pointer to the buffer to copy from
+/// @param size amount of memory to copy
+/// @param desc used in the debug messages to describe the copy
+/// @return ESP_OK if successful. Otherwise ESP_FAIL
+IRAM_ATTR esp_err_t CopyBuffer_fast_memcpy(void* dest, void* source, uint32_t size, const char *desc, const bool useCache)
+{
+
+#ifdef USE_CACHE
+    // Prepare the cache
+    const bool needFlush = prepareCache(dest, source, size, useCache);
+#endif
+
+    // Start our performance timer
+    Perf_Begin();
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    // Do the work - using the region-aware dispatcher
+    fast_memcpy(dest, source, size);
+
+#ifdef USE_CACHE
+    // Flush the cache if needed
+    if (needFlush) {
+        compiler_mem_barrier(dest,size);
+        flushCache(dest, size);
+    }
+#endif
+
+    // Display the resuilts
+    const uint32_t tstop = esp_cpu_get_cycle_count();
+    Perf_End();
+    Display_Results("fast_memcpy ", desc, tstart, tstop, dest, source, size);
+
+    return ESP_OK;
+
+}
+
 /**
  * @brief Fill \p dest with 0 and make sure the data has passed the cache.
  * 
  * @param dest 
  * @param size 
  */
-static void clearBuffer(void* dest, size_t size) {
-    memset(dest,0,size);
+void clearBuffer(void* dest, size_t size) {
+    fast_memset(dest,0,size);
     if(isExtMem(dest)) {
         flushCache(dest,size);
     }    
 }
 
+#ifdef USE_PERFMON
+/// @brief Runs a CopyBuffer_* call once per group of performance counter events.
+/// Only the last run is logged, together with the counters.
+#define PERF_RUN(call) \
+    for (uint32_t group = 0; group < Perf_Group_Count(); group++) { \
+        const bool last = (group + 1 == Perf_Group_Count()); \
+        Perf_Select(group); \
+        esp_log_level_set(TAG, last ? ESP_LOG_INFO : ESP_LOG_NONE); \
+        call; \
+        if (!last) clearBuffer(dest,size); \
+    }
+#else
+#define PERF_RUN(call) call
+#endif
+
 /// @brief Copies a buffer using all the different methods
 /// @param dest pointer to the buffer to copy to
 /// @param source pointer to the buffer to copy from
@@ -729,19 +522,19 @@ IRAM_ATTR esp_err_t CopyBuffer(void* dest, void* source, uint32_t size, uint32_t
     clearBuffer(dest,size);
 
     // No meaningful difference between a for loop and a while loop
-    CopyBuffer_ForLoop<uint8_t>(dest, source, size, "8-bit ", desc, useCache);
+    PERF_RUN(CopyBuffer_ForLoop<uint8_t>(dest, source, size, "8-bit ", desc, useCache));
     
     clearBuffer(dest,size);
 
-    CopyBuffer_ForLoop<uint16_t>(dest, source, size, "16-bit ", desc, useCache);
+    PERF_RUN(CopyBuffer_ForLoop<uint16_t>(dest, source, size, "16-bit ", desc, useCache));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_ForLoop<uint32_t>(dest, source, size, "32-bit ", desc, useCache);
+    PERF_RUN(CopyBuffer_ForLoop<uint32_t>(dest, source, size, "32-bit ", desc, useCache));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_ForLoop<uint64_t>(dest, source, size, "64-bit ", desc, useCache);
+    PERF_RUN(CopyBuffer_ForLoop<uint64_t>(dest, source, size, "64-bit ", desc, useCache));
 
     clearBuffer(dest,size);
 
@@ -750,23 +543,27 @@ IRAM_ATTR esp_err_t CopyBuffer(void* dest, void* source, uint32_t size, uint32_t
     // CopyBuffer_32BitForLoop(dest, source, size, desc);
     // CopyBuffer_64BitForLoop(dest, source, size, desc);
 
-    CopyBuffer_memcpy(dest, source, size, desc, useCache);
+    PERF_RUN(CopyBuffer_memcpy(dest, source, size, desc, useCache));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_DMA(dest, source, size, align, desc);
+    PERF_RUN(CopyBuffer_DMA(dest, source, size, align, desc));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_PIE_128bit_16bytes(dest, source, size, desc, useCache);
+    PERF_RUN(CopyBuffer_PIE_128bit_16bytes(dest, source, size, desc, useCache));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_PIE_128bit_32bytes(dest, source, size, desc, useCache);
+    PERF_RUN(CopyBuffer_PIE_128bit_32bytes(dest, source, size, desc, useCache));
 
     clearBuffer(dest,size);
 
-    CopyBuffer_DSP(dest, source, size, desc, useCache);
+    PERF_RUN(CopyBuffer_DSP(dest, source, size, desc, useCache));
+
+    clearBuffer(dest,size);
+
+    PERF_RUN(CopyBuffer_fast_memcpy(dest, source, size, desc, useCache));
 
     clearBuffer(dest,size);
 
@@ -788,18 +585,22 @@ void IRAM_ATTR MemoryCopy_V1(uint32_t size, uint32_t align)
 #endif
 
     // Hello world
-    ESP_LOGI(TAG, "\n\nmemory copy version 1.3\n");
+    ESP_LOGI(TAG, "\n\nmemory copy version 1.4\n");
     if (useCache)
         ESP_LOGI(TAG, "Using PSRAM CACHE flush\n");
     else
         ESP_LOGI(TAG, "NOT flushing PSRAM CACHE\n");
 
+    // At most two buffers of each kind are in use at a time
+    Buffers_Start(size);
+
     // Test copying from IRAM to IRAM using 32 byte alignment
     ESP_LOGI(TAG, "Allocating 2 x %" PRIu32 "kb in IRAM, alignment: %" PRIu32 " bytes", size/1024, align);
-    _source = heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
-    _dest = heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    _source = Buffer_Acquire(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    _dest = Buffer_Acquire(align, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
     if(!_dest || !_source) {
         ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffers_Stop();
         return;
     }
     Initialize_Buffer(_source, size);
@@ -808,11 +609,12 @@ void IRAM_ATTR MemoryCopy_V1(uint32_t size, uint32_t align)
     // Test copying from IRAM to PSRAM using 32 byte alignment
     printf("\n");
     ESP_LOGI(TAG, "Freeing %" PRIu32 "kb from IRAM", size/1024);
-    free(_dest);
+    Buffer_Release(_dest);
     ESP_LOGI(TAG, "Allocating %" PRIu32 "kb in PSRAM, alignment: %" PRIu32 " bytes", size/1024, align);
-    _dest = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM);
+    _dest = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
     if(!_dest || !_source) {
         ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffers_Stop();
         return;
     }
     CopyBuffer(_dest, _source, size, align, useCache, "IRAM->PSRAM");
@@ -827,18 +629,20 @@ void IRAM_ATTR MemoryCopy_V1(uint32_t size, uint32_t align)
     // Test copying from PSRAM to PSRAM using 32 byte alignment
     printf("\n");
     ESP_LOGI(TAG, "Freeing %" PRIu32 "kb from IRAM", size/1024);
-    free(_dest);
+    Buffer_Release(_dest);
     ESP_LOGI(TAG, "Allocating %" PRIu32 "kb in PSRAM, alignment: %" PRIu32 " bytes", size/1024, align);
-    _dest = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM);
+    _dest = Buffer_Acquire(align, size, MALLOC_CAP_SPIRAM);
     if(!_dest || !_source) {
         ESP_LOGE(TAG, "Memory Allocation failed");
+        Buffers_Stop();
         return;
     }
     CopyBuffer(_dest, _source, size, align, useCache, "PSRAM->PSRAM");
 
     // Free the memory
-    free(_source);
-    free(_dest);
+    Buffer_Release(_source);
+    Buffer_Release(_dest);
+    Buffers_Stop();
 
 }
 
@@ -846,6 +650,132 @@ void IRAM_ATTR MemoryCopy_V1(uint32_t size, uint32_t align)
 /// @brief Main application entry point
 extern "C" void app_main(void)
 {
+#ifdef RUN_COPY_V1
     // Run the copy on 100KB of data with cache line alignment
     MemoryCopy_V1(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_SIZE_SWEEP
+    // Run every method on power-of-two sizes from 16 bytes to 4MB
+    MemoryCopy_Sweep(16, 4 * 1024 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_UNALIGNED
+    // Run the PIE kernels on misaligned buffers and odd sizes around 100KB
+    MemoryCopy_Unaligned(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_STATS
+    // Run every method on 100KB with 3 warmup runs and 100 samples, rejecting outliers beyond 5 MAD
+    const RunnerConfig runner = { .warmup = 3, .repetitions = 100, .outlierLimit = 5.0f };
+    MemoryCopy_Stats(100 * 1024, internal::getCacheLineSize(), runner);
+#endif
+
+#ifdef RUN_DMA_SERVICE
+    // Compare per-call async_memcpy installs with the persistent service, 100KB in 4KB requests
+    MemoryCopy_DmaService(100 * 1024, 4 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_HYBRID
+    // Calibrate the DMA/CPU split of the hybrid copy on 1MB per region pair
+    MemoryCopy_Hybrid(1024 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_PARALLEL
+    // Compare one core against both cores copying at once, for 4KB to 96KB
+    MemoryCopy_Parallel(internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_FILL
+    // Zero and fill 100KB of IRAM and PSRAM with every fill method
+    MemoryFill(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_BLIT
+    // Copy 240, 320 and 480 pixel wide RGB565 rectangles between 480 pixel wide framebuffers
+    MemoryCopy_Blit(internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_STREAM
+    // Stream 1MB of PSRAM through 4KB and 16KB internal RAM tiles
+    MemoryCopy_Stream(1024 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_PREFETCH
+    // Copy 100KB out of PSRAM with cache preload distances from 256 bytes to 8KB
+    MemoryCopy_Prefetch(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_PHASES
+    // Break every copy of 100KB down into prepare, kernel, write-back and verify
+    MemoryCopy_Phases(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_CACHE_SYNC
+    // Compare esp_cache_msync with the ROM cache functions, 64 bytes to 100KB
+    Cache_Sync_Compare(internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_UNROLL
+    // Run the 24 PIE unroll variants on ~92KB, a multiple of 16 * 1..8 bytes, with 1 warmup run and 20 samples
+    const RunnerConfig unrollRunner = { .warmup = 1, .repetitions = 20, .outlierLimit = 5.0f };
+    MemoryCopy_Unroll(16 * 840 * 7, internal::getCacheLineSize(), unrollRunner);
+#endif
+
+#ifdef RUN_SMALL
+    // Cycles per call of memcpy, DSP AES3 and copy<N>() for 16 to 256 bytes of IRAM
+    MemoryCopy_Small(internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_PLACEMENT
+    // Internal RAM with and without DMA, same and different SRAM blocks and RTC fast memory.
+    // 2KB fits in RTC fast memory, 16KB shows the SRAM placements without the call overhead.
+    const RunnerConfig placementRunner = { .warmup = 2, .repetitions = 50, .outlierLimit = 5.0f };
+    MemoryCopy_Placement(2 * 1024, internal::getCacheLineSize(), placementRunner);
+    MemoryCopy_Placement(16 * 1024, internal::getCacheLineSize(), placementRunner);
+#endif
+
+#ifdef RUN_CONTENTION
+    // Run every method on 100KB, idle and under each background load on the other core
+    const RunnerConfig contentionRunner = { .warmup = 2, .repetitions = 30, .outlierLimit = 5.0f };
+    MemoryCopy_Contention(100 * 1024, internal::getCacheLineSize(), contentionRunner, LOAD_ALL);
+#endif
+
+#ifdef RUN_MOVE
+    // Shift 100KB up and down within IRAM and PSRAM by 1 byte up to a 960 byte framebuffer row
+    MemoryMove(100 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_POOL
+    // Compare heap_caps_aligned_alloc/free with the buffer pool for latency and fragmentation
+    Buffer_Pool_Compare();
+#endif
+
+#ifdef RUN_BOUNCE
+    // Copy 300KB PSRAM->PSRAM through 1KB to 16KB internal RAM tiles, with and without the DMA
+    const RunnerConfig bounceRunner = { .warmup = 2, .repetitions = 20, .outlierLimit = 5.0f };
+    MemoryCopy_Bounce(300 * 1024, internal::getCacheLineSize(), bounceRunner);
+#endif
+
+#ifdef RUN_TRANSFORM
+    // Byte swaps, a mask and RGB888->RGB565 on 96KB, fused into the copy against copy-then-transform
+    MemoryCopy_Transform(96 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_CHUNKED
+    // Copy 2MB of PSRAM by DMA in 4KB to 1MB chunks with 1 to 8 in flight
+    MemoryCopy_Chunked(2 * 1024 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_CORO
+    // DMA and checksum 256KB of PSRAM in 4KB tiles, blocking and as coroutines
+    MemoryCopy_Coro(256 * 1024, internal::getCacheLineSize());
+#endif
+
+#ifdef RUN_FREQUENCY
+    // Every method and region pair on 100KB at 80, 160 and 240 MHz. Needs CONFIG_PM_ENABLE.
+    const RunnerConfig frequencyRunner = { .warmup = 1, .repetitions = 10, .outlierLimit = 5.0f };
+    MemoryCopy_Frequency(100 * 1024, internal::getCacheLineSize(), frequencyRunner);
+#endif
+
 }
\ No newline at end of file
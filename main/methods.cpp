@@ -0,0 +1,172 @@
+/*
+* The table of copy methods and region pairs shared by the benchmark modes.
+*
+*/
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "dsps_mem.h"
+
+#include "fastcopy.h"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/hybrid.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+
+static IRAM_ATTR void kernel_memcpy(void* dest, const void* source, size_t size) {
+    memcpy(dest, source, size);
+}
+
+static IRAM_ATTR void kernel_dma(void* dest, const void* source, size_t size) {
+    copy_dma(dest, source, size);
+}
+
+static IRAM_ATTR void kernel_dsp(void* dest, const void* source, size_t size) {
+    dsps_memcpy_aes3(dest, const_cast<void*>(source), size);
+}
+
+static IRAM_ATTR void kernel_prefetch(void* dest, const void* source, size_t size) {
+    copy_prefetch(dest, source, size);
+}
+
+static IRAM_ATTR void kernel_hybrid(void* dest, const void* source, size_t size) {
+    copy_hybrid(dest, source, size);
+}
+
+static IRAM_ATTR void kernel_fast_memcpy(void* dest, const void* source, size_t size) {
+    fast_memcpy(dest, source, size);
+}
+
+
+const CopyMethod copyMethods[] = {
+    { "8-bit for loop copy ",        &copy_forloop<uint8_t>,  1,  true,  false },
+    { "16-bit for loop copy ",       &copy_forloop<uint16_t>, 2,  true,  false },
+    { "32-bit for loop copy ",       &copy_forloop<uint32_t>, 4,  true,  false },
+    { "64-bit for loop copy ",       &copy_forloop<uint64_t>, 8,  true,  false },
+    { "memcpy ",                     &kernel_memcpy,          1,  true,  false },
+    { "async_memcpy ",               &kernel_dma,             1,  false, false },
+    { "PIE 128-bit (16 byte loop) ", &copy_pie_16,            16, true,  false },
+    { "PIE 128-bit (32 byte loop) ", &copy_pie_32,            32, true,  false },
+    { "PIE 128-bit unaligned ",      &copy_pie_unaligned,     1,  true,  false },
+    { "PIE 128-bit prefetch ",       &kernel_prefetch,        1,  true,  false },
+    { "DSP AES3 ",                   &kernel_dsp,             1,  true,  false },
+    { "Hybrid DMA+CPU ",             &kernel_hybrid,          1,  true,  false },
+    { "fast_memcpy ",                &kernel_fast_memcpy,     1,  true,  true  },
+};
+const size_t copyMethodCount = sizeof(copyMethods) / sizeof(copyMethods[0]);
+
+
+const RegionPair regionPairs[] = {
+    { "IRAM->IRAM",   MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA },
+    { "IRAM->PSRAM",  MALLOC_CAP_SPIRAM,                    MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA },
+    { "PSRAM->IRAM",  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, MALLOC_CAP_SPIRAM },
+    { "PSRAM->PSRAM", MALLOC_CAP_SPIRAM,                    MALLOC_CAP_SPIRAM },
+};
+const size_t regionPairCount = sizeof(regionPairs) / sizeof(regionPairs[0]);
+
+
+const CopyMethod* Find_Method(const char* name) {
+    const size_t len = strlen(name);
+    for(size_t i = 0; i < copyMethodCount; i++) {
+        if(strncmp(copyMethods[i].name, name, len) == 0 && copyMethods[i].name[len] == ' ') {
+            return &copyMethods[i];
+        }
+    }
+    return nullptr;
+}
+
+
+std::string Method_Label(const CopyMethod& method) {
+    std::string label(method.name);
+    while(!label.empty() && label.back() == ' ') {
+        label.pop_back();
+    }
+    return label;
+}
+
+
+bool Method_Supports(const CopyMethod& method, void* dest, void* source, size_t size) {
+    if((size % method.granularity) != 0) {
+        return false;
+    }
+    const uint32_t align = method.granularity < 16 ? method.granularity : 16;
+    if((((uintptr_t)dest | (uintptr_t)source) & (align-1)) != 0) {
+        return false;
+    }
+    if(method.kernel == &kernel_dma) {
+        return dma_capable(dest, source, size);
+    }
+    return true;
+}
+
+
+/// @brief Widens a memory region to whole cache lines, as esp_cache_msync requires
+static inline void Cache_Lines(void*& addr, size_t& size) {
+    const uintptr_t ls = internal::getCacheLineSize();
+    const uintptr_t start = (uintptr_t)addr & ~(ls-1);
+    const uintptr_t end = ((uintptr_t)addr + size + (ls-1)) & ~(ls-1);
+    addr = (void*)start;
+    size = end - start;
+}
+
+
+IRAM_ATTR uint32_t Time_Copy(const CopyMethod& method, void* dest, void* source, size_t size, bool useCache,
+                             CopyPhases* phases)
+{
+
+    const uint32_t tprepare = esp_cpu_get_cycle_count();
+
+#ifdef USE_CACHE
+    // Prepare the cache. The DMA kernel takes care of the cache itself.
+    // Misaligned buffers are prepared and flushed as whole cache lines.
+    void* cacheDest = dest;
+    size_t cacheDestSize = size;
+    Cache_Lines(cacheDest, cacheDestSize);
+    bool needFlush = false;
+    if (method.cpu) {
+        void* cacheSource = source;
+        size_t cacheSourceSize = size;
+        Cache_Lines(cacheSource, cacheSourceSize);
+        compiler_mem_barrier(source,size);
+        if (useCache && isExtMem(source)) {
+            uncacheForRead(cacheSource, cacheSourceSize);
+        }
+        if (useCache && isExtMem(dest)) {
+            needFlush = uncacheForWrite(cacheDest, cacheDestSize);
+        }
+    }
+#endif
+
+    // Start our performance timer
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    method.kernel(dest, source, size);
+
+    const uint32_t tkernel = esp_cpu_get_cycle_count();
+
+#ifdef USE_CACHE
+    // Flush the cache if needed
+    if (needFlush) {
+        compiler_mem_barrier(dest,size);
+        flushCache(cacheDest, cacheDestSize);
+    }
+#endif
+
+    const uint32_t tstop = esp_cpu_get_cycle_count();
+
+    if (phases) {
+        phases->prepare = tstart - tprepare;
+        phases->kernel = tkernel - tstart;
+        phases->flush = tstop - tkernel;
+    }
+
+    return tstop - tstart;
+
+}
@@ -0,0 +1,230 @@
+/*
+* Move test: memmove, the PIE memmove kernel and fast_memmove shifting data
+* within one IRAM or PSRAM buffer, up and down, by a few bytes up to a
+* framebuffer row.
+*
+* The buffer is prepared and flushed as in the copy tests, so a move within
+* PSRAM only counts as done once it has been written back.
+*
+* The timed moves start GUARD bytes into the buffer and end GUARD bytes before
+* its end, and every byte outside the destination, those guards included, must
+* still match the reference afterwards. Before timing anything, every method
+* also makes untimed moves of a few bytes, around the PIE block size and at
+* odd sizes, by 1, 15 and 16 bytes both ways from every offset within a block.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy.h"
+#include "fastcopy/cache.hpp"
+#include "fastcopy/kernels.hpp"
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace fastcopy;
+
+static const char *TAG = "Move";
+
+struct MoveMethod {
+    const char* name;
+    CopyKernel kernel;
+};
+
+/// @brief A single memory region to move data within
+struct Region {
+    const char* desc;
+    uint32_t caps;
+};
+
+
+static IRAM_ATTR void move_memmove(void* dest, const void* source, size_t size) {
+    memmove(dest, source, size);
+}
+
+static IRAM_ATTR void move_fast_memmove(void* dest, const void* source, size_t size) {
+    fast_memmove(dest, source, size);
+}
+
+
+static const MoveMethod moveMethods[] = {
+    { "memmove ",      &move_memmove      },
+    { "PIE memmove ",  &move_pie          },
+    { "fast_memmove ", &move_fast_memmove },
+};
+
+static const Region regions[] = {
+    { "IRAM",  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA },
+    { "PSRAM", MALLOC_CAP_SPIRAM },
+};
+
+/// @brief Shift distances in bytes: misaligned, word, PIE block, and one 480 pixel RGB565 row
+static const uint32_t shifts[] = { 1, 4, 16, 100, 960 };
+
+/// @brief Bytes before and after the moved range that must be left alone
+static const uint32_t GUARD = 32;
+
+/// @brief Sizes of the untimed moves: either side of a PIE block, and odd sizes
+static const uint32_t smallSizes[] = { 1, 3, 15, 16, 17, 31, 33, 63, 65, 127, 255 };
+
+/// @brief Distances of the untimed moves, down (negative) and up
+static const int32_t smallDistances[] = { -16, -15, -1, 1, 15, 16 };
+
+/// @brief Room for the untimed moves: the largest size and distance, every offset within a block, and the guards
+static const uint32_t SMALL_WINDOW = GUARD + 16 + 16 + 255 + 16 + GUARD;
+
+
+/// @brief Checks a move of \p size bytes from \p sourceOffset to \p destOffset within \p buffer: the
+/// destination holds the source bytes of \p reference, and every other byte of \p length still matches it
+static bool Check_Move(const uint8_t* buffer, const uint8_t* reference, size_t length,
+                       size_t destOffset, size_t sourceOffset, size_t size)
+{
+    return fastcopy::equal(reference + sourceOffset, buffer + destOffset, size) &&
+           fastcopy::equal(reference, buffer, destOffset) &&
+           fastcopy::equal(reference + destOffset + size, buffer + destOffset + size, length - destOffset - size);
+}
+
+
+/// @brief Moves a few bytes with \p method at every size, distance and offset within a block, untimed
+/// @return the number of moves that failed Check_Move()
+static uint32_t Check_Small_Moves(const MoveMethod& method, uint8_t* buffer, const uint8_t* reference)
+{
+    uint32_t failed = 0;
+    for (uint32_t size : smallSizes) {
+        for (int32_t distance : smallDistances) {
+            for (uint32_t offset = 0; offset < 16; offset++) {
+                // Room below the source for the largest downward distance.
+                const uint32_t sourceOffset = GUARD + 16 + offset;
+                const uint32_t destOffset = sourceOffset + distance;
+
+                memcpy(buffer, reference, SMALL_WINDOW);
+                method.kernel(buffer + destOffset, buffer + sourceOffset, size);
+                if (!Check_Move(buffer, reference, SMALL_WINDOW, destOffset, sourceOffset, size)) {
+                    if (failed++ == 0)
+                        ESP_LOGE(TAG, "%s%" PRIu32 " bytes at +%" PRIu32 " by %+" PRIi32 " failed because the buffers don't match!",
+                                 method.name, size, offset, distance);
+                }
+            }
+        }
+    }
+    return failed;
+}
+
+
+/// @brief Restores \p buffer from \p reference and times one move within it, with the same
+/// cache preparation and flushing as Time_Copy
+static IRAM_ATTR uint32_t Time_Move(CopyKernel kernel, void* buffer, const void* reference, size_t bufferSize,
+                                    void* dest, const void* source, size_t size, bool useCache)
+{
+
+    memcpy(buffer, reference, bufferSize);
+    bool needFlush = false;
+    if (isExtMem(buffer)) {
+        flushCache(buffer, bufferSize);
+        if (useCache) {
+            needFlush = uncacheForRead(buffer, bufferSize);
+        }
+    }
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    kernel(dest, source, size);
+
+    if (needFlush) {
+        compiler_mem_barrier(buffer, bufferSize);
+        flushCache(buffer, bufferSize);
+    }
+
+    return esp_cpu_get_cycle_count() - tstart;
+
+}
+
+
+/// @brief Shifts data up and down within IRAM and PSRAM buffers with every move method
+/// @param size The size of the memory to move
+/// @param align The alignment size to use when allocating the memory
+void MemoryMove(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nmove test, %" PRIu32 "kb\n", size/1024);
+
+    // Room for the largest shift and the guards, in whole cache lines so the buffer can be flushed as one
+    uint32_t maxShift = 0;
+    for (uint32_t shift : shifts) {
+        if (shift > maxShift)
+            maxShift = shift;
+    }
+    uint32_t bufferSize = (GUARD + size + maxShift + GUARD + align - 1) & ~(align - 1);
+    if (bufferSize < SMALL_WINDOW)
+        bufferSize = (SMALL_WINDOW + align - 1) & ~(align - 1);
+
+    Buffers_Start(bufferSize);
+
+    for (const Region& region : regions) {
+        uint8_t* buffer = (uint8_t*)Buffer_Acquire(align, bufferSize, region.caps);
+        uint8_t* reference = (uint8_t*)Buffer_Acquire(align, bufferSize, region.caps);
+        if (!buffer || !reference) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(buffer);
+            Buffer_Release(reference);
+            break;
+        }
+        Initialize_Buffer(reference, bufferSize);
+
+        for (const MoveMethod& method : moveMethods) {
+            const uint32_t failed = Check_Small_Moves(method, buffer, reference);
+            if (failed)
+                ESP_LOGE(TAG, "%s%s: %" PRIu32 " small moves failed", method.name, region.desc, failed);
+            else
+                ESP_LOGI(TAG, "%s%s: small moves OK", method.name, region.desc);
+        }
+
+        for (uint32_t shift : shifts) {
+            // Up moves the data to higher addresses (backward copy), down to lower ones (forward copy)
+            for (int up = 1; up >= 0; up--) {
+                char desc[48];
+                snprintf(desc, sizeof(desc), "%s %s by %" PRIu32, region.desc, up ? "up" : "down", shift);
+                const uint32_t sourceOffset = GUARD + (up ? 0 : shift);
+                const uint32_t destOffset = GUARD + (up ? shift : 0);
+
+                for (const MoveMethod& method : moveMethods) {
+                    const uint32_t cycles = Time_Move(method.kernel, buffer, reference, bufferSize,
+                                                      buffer + destOffset, buffer + sourceOffset, size, useCache);
+                    if (Check_Move(buffer, reference, bufferSize, destOffset, sourceOffset, size))
+                        Display_Performance(method.name, desc, 0, cycles, size);
+                    else
+                        ESP_LOGE(TAG, "%s%s failed because the buffers don't match!", method.name, desc);
+
+                    // Give the log output some time to finish before the next test is run.
+                    vTaskDelay(50/portTICK_PERIOD_MS);
+                }
+                printf("\n");
+            }
+        }
+
+        Buffer_Release(buffer);
+        Buffer_Release(reference);
+    }
+
+    Buffers_Stop();
+
+}
@@ -0,0 +1,106 @@
+/*
+* Dual-core copy test: the same copy done by one core and by both cores at once,
+* to see whether a region pair's bandwidth scales with a second core or is already
+* saturated by one.
+*
+* Both runs go through fastcopy::ParallelCopy, so the task wake-up costs are the
+* same and only the split differs. Each core writes back its own slice of a PSRAM
+* destination.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/parallel.hpp"
+
+#include "benchmark.h"
+
+using namespace std;
+using namespace fastcopy;
+
+static const char *TAG = "Parallel";
+
+/// @brief Copy sizes tried for each region pair
+static const uint32_t sizes[] = { 4 * 1024, 32 * 1024, 96 * 1024 };
+
+
+/// @brief Times one copy by \p cores cores, including the write-back of a PSRAM destination
+static uint32_t Time_Parallel(ParallelCopy& parallel, uint32_t cores, void* dest, void* source, uint32_t size, bool useCache)
+{
+    clearBuffer(dest, size);
+    prepareCache(dest, source, size, useCache);
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+    parallel.copy(dest, source, size, cores, nullptr, useCache);
+    return esp_cpu_get_cycle_count() - tstart;
+}
+
+
+/// @brief Copies every region pair on one core and on both cores and reports the speedup
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Parallel(uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\ndual-core copy\n");
+
+    // Above the calling task, so nothing else gets in while the caller is blocked.
+    ParallelCopy parallel;
+    if(parallel.start(uxTaskPriorityGet(nullptr) + 1) != ESP_OK) {
+        return;
+    }
+
+    // One size class of the largest size, which the smaller ones fit too
+    Buffers_Start(sizes[sizeof(sizes) / sizeof(sizes[0]) - 1]);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        for (uint32_t size : sizes) {
+            void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+            void* dest = Buffer_Acquire(align, size, pair.destCaps);
+            if(!dest || !source) {
+                ESP_LOGE(TAG, "Memory Allocation failed for %s %" PRIu32 " bytes", pair.desc, size);
+                Buffer_Release(source);
+                Buffer_Release(dest);
+                continue;
+            }
+            Initialize_Buffer(source, size);
+
+            char desc[48];
+            snprintf(desc, sizeof(desc), "%s %" PRIu32 " bytes", pair.desc, size);
+
+            const uint32_t single = Time_Parallel(parallel, 1, dest, source, size, useCache);
+            Display_Results("1 core ", desc, 0, single, dest, source, size);
+
+            const uint32_t dual = Time_Parallel(parallel, portNUM_PROCESSORS, dest, source, size, useCache);
+            Display_Results("2 cores ", desc, 0, dual, dest, source, size);
+
+            ESP_LOGI(TAG, "%s: speedup %.2fx, slices core 0 %" PRIu32 " / core 1 %" PRIu32 " cycles",
+                     desc, (float)single / dual, parallel.sliceCycles(0), parallel.sliceCycles(1));
+            printf("\n");
+
+            Buffer_Release(source);
+            Buffer_Release(dest);
+        }
+    }
+
+    Buffers_Stop();
+    parallel.stop();
+
+}
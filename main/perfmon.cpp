@@ -0,0 +1,104 @@
+/*
+* Performance counter instrumentation for the single-size test.
+*
+* The LX7 has two performance counters, so each copy is run once per pair of
+* events (see perfGroups) and only the last run is logged. Perf_Begin() and
+* Perf_End() sit right next to the cycle count reads in the CopyBuffer_* functions,
+* so the counters cover the same span as the reported cycles.
+*
+* The ESP32-S3's caches are outside the CPU core, so the core can't count cache
+* misses as such. A miss in the PSRAM cache shows up as data stall cycles.
+*
+*/
+
+#include "benchmark.h"
+
+#ifdef USE_PERFMON
+
+#include <inttypes.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "perfmon.h"
+
+static const char *TAG = "Perfmon";
+
+/// @brief An event counted by one performance counter
+struct PerfEvent {
+    uint16_t select;
+    uint16_t mask;
+};
+
+/// @brief The events counted in each run, two at a time
+static const PerfEvent perfGroups[][2] = {
+    { { XTPERF_CNT_INSN,    XTPERF_MASK_INSN_ALL },
+      { XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_ALL } },
+    { { XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_CACHE_MISS | XTPERF_MASK_D_STALL_BUSY | XTPERF_MASK_D_STALL_IN_PIF },
+      { XTPERF_CNT_D_STALL, XTPERF_MASK_D_STALL_STORE_BUF_FULL | XTPERF_MASK_D_STALL_STORE_BUF_CONFLICT } },
+    { { XTPERF_CNT_I_STALL, XTPERF_MASK_I_STALL_ALL },
+      { XTPERF_CNT_BUBBLES, XTPERF_MASK_BUBBLES_ALL } },
+};
+
+static const uint32_t PERF_GROUPS = sizeof(perfGroups) / sizeof(perfGroups[0]);
+
+/// @brief Counter values of the current copy, in the same layout as perfGroups
+static uint32_t values[PERF_GROUPS][2];
+
+static uint32_t group;
+static bool armed;
+
+
+uint32_t Perf_Group_Count()
+{
+    return PERF_GROUPS;
+}
+
+
+void Perf_Select(uint32_t g)
+{
+    if (g == 0) {
+        for (auto& v : values)
+            v[0] = v[1] = 0;
+    }
+    group = g;
+    armed = true;
+}
+
+
+IRAM_ATTR void Perf_Begin()
+{
+    if (!armed)
+        return;
+    for (int id = 0; id < 2; id++) {
+        xtensa_perfmon_init(id, perfGroups[group][id].select, perfGroups[group][id].mask, 0, -1);
+        xtensa_perfmon_reset(id);
+    }
+    xtensa_perfmon_start();
+}
+
+
+IRAM_ATTR void Perf_End()
+{
+    if (!armed)
+        return;
+    xtensa_perfmon_stop();
+
+    values[group][0] = xtensa_perfmon_value(0);
+    values[group][1] = xtensa_perfmon_value(1);
+}
+
+
+void Perf_Report(std::string prefix, std::string desc, uint32_t cycles)
+{
+    if (!armed || group + 1 != PERF_GROUPS)
+        return;
+    armed = false;
+
+    ESP_LOGI(TAG, "%s%s %" PRIu32 " instructions (%.2f IPC), stalls: data %" PRIu32 " (load %" PRIu32 ", store %" PRIu32 "), instruction %" PRIu32 ", bubbles %" PRIu32,
+             prefix.c_str(), desc.c_str(), values[0][0],
+             cycles ? (float)values[0][0] / cycles : 0.0f,
+             values[0][1], values[1][0], values[1][1],
+             values[2][0], values[2][1]);
+}
+
+#endif
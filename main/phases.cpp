@@ -0,0 +1,88 @@
+/*
+* Phase test: splits every copy into cache preparation, the kernel, the cache
+* write-back and verification, and reports the four side by side.
+*
+* The copy time reported by the other tests is kernel + write-back. The async_memcpy
+* kernel does its own cache maintenance, which is then part of its kernel time.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+static const char *TAG = "Phases";
+
+
+/// @brief Times the prepare, kernel, write-back and verify phases of every method on every region pair
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Phases(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nphase breakdown, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        for (size_t m = 0; m < copyMethodCount; m++) {
+            const CopyMethod& method = copyMethods[m];
+            if (!Method_Supports(method, dest, source, size))
+                continue;
+
+            CopyPhases phases = {};
+            clearBuffer(dest, size);
+            Time_Copy(method, dest, source, size, useCache, &phases);
+
+            const uint32_t tverify = esp_cpu_get_cycle_count();
+            const bool match = fastcopy::equal(source, dest, size);
+            phases.verify = esp_cpu_get_cycle_count() - tverify;
+
+            if (match) {
+                ESP_LOGI(TAG, "%s%s prepare %" PRIu32 ", kernel %" PRIu32 ", write-back %" PRIu32 ", verify %" PRIu32 " cycles, write-back is %.1f%% of the copy",
+                         method.name, pair.desc, phases.prepare, phases.kernel, phases.flush, phases.verify,
+                         100.0f * phases.flush / (phases.kernel + phases.flush));
+            } else {
+                ESP_LOGE(TAG, "%s%s failed because the buffers don't match!", method.name, pair.desc);
+            }
+
+            // Give the log output some time to finish before the next test is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
@@ -0,0 +1,239 @@
+/*
+* Placement test: the internal memory regions the single-size test doesn't cover.
+*
+* + internal RAM allocated with and without MALLOC_CAP_DMA
+* + source and destination in the same 64kb SRAM block and in different blocks
+* + RTC fast memory as source, destination or both
+*
+* Every placement runs the CPU kernels (and async_memcpy where the DMA can reach
+* the buffers) through the statistical runner. The median bandwidths are printed
+* as CSV, followed by the difference between same-block and different-block copies.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "soc/soc.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "benchmark.h"
+
+static const char *TAG = "Placement";
+
+/// @brief Internal SRAM on the data bus is split into SRAM1 (up to here) and SRAM2.
+/// The heap regions in soc_memory_layout.c are 64kb blocks of these.
+static const uintptr_t SRAM2_START = 0x3FCF0000;
+static const uintptr_t SRAM_BLOCK_SIZE = 64 * 1024;
+
+/// @brief Number of buffers allocated while looking for two in the same or in different blocks
+static const uint32_t MAX_CANDIDATES = 12;
+
+/// @brief Where the source and destination must lie relative to each other
+enum class Blocks { Any, Same, Different };
+
+struct Placement {
+    /// @brief Used in the debug messages
+    const char* desc;
+    /// @brief heap_caps flags for the destination buffer
+    uint32_t destCaps;
+    /// @brief heap_caps flags for the source buffer
+    uint32_t sourceCaps;
+    Blocks blocks;
+};
+
+static const Placement placements[] = {
+    { "SRAM->SRAM DMA capable",       MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  Blocks::Any },
+    { "SRAM->SRAM no DMA cap",        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, Blocks::Any },
+    { "SRAM->SRAM same block",        MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  Blocks::Same },
+    { "SRAM->SRAM different blocks",  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  Blocks::Different },
+    { "RTC fast->SRAM",               MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  MALLOC_CAP_RTCRAM,                     Blocks::Any },
+    { "SRAM->RTC fast",               MALLOC_CAP_RTCRAM,                     MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,  Blocks::Any },
+    { "RTC fast->RTC fast",           MALLOC_CAP_RTCRAM,                     MALLOC_CAP_RTCRAM,                     Blocks::Any },
+};
+static const size_t placementCount = sizeof(placements) / sizeof(placements[0]);
+
+static const char* const placementMethods[] = {
+    "32-bit for loop copy",
+    "memcpy",
+    "async_memcpy",
+    "PIE 128-bit (16 byte loop)",
+    "PIE 128-bit (32 byte loop)",
+    "DSP AES3",
+};
+static const size_t placementMethodCount = sizeof(placementMethods) / sizeof(placementMethods[0]);
+
+
+/// @brief Numbers the internal SRAM blocks, -1 for anything else
+static int SRAM_Block(const void* ptr) {
+    const uintptr_t addr = (uintptr_t)ptr;
+    if(addr < SOC_DRAM_LOW || addr >= SOC_DRAM_HIGH) {
+        return -1;
+    }
+    return (addr - (SOC_DRAM_LOW & ~(SRAM_BLOCK_SIZE-1))) / SRAM_BLOCK_SIZE;
+}
+
+/// @brief Describes where \p ptr is, e.g. "SRAM1 block 2"
+static std::string Region_Name(const void* ptr) {
+    if(esp_ptr_in_rtc_dram_fast(ptr)) {
+        return "RTC fast";
+    }
+    const int block = SRAM_Block(ptr);
+    if(block < 0) {
+        return "other";
+    }
+    std::string name = (uintptr_t)ptr >= SRAM2_START ? "SRAM2" : "SRAM1";
+    name += " block " + std::to_string(block);
+    if(!esp_ptr_dma_capable(ptr)) {
+        name += ", not DMA capable";
+    }
+    return name;
+}
+
+/// @brief Allocates many buffers and keeps the first two that are in the same or in different blocks.
+/// These come from the heap rather than the pool, as the point is which block the heap puts them in.
+static bool Allocate_Blocks(bool same, uint32_t size, uint32_t align, uint32_t caps, void** dest, void** source) {
+    void* candidates[MAX_CANDIDATES] = {};
+    uint32_t count = 0;
+    int first = -1, second = -1;
+
+    for(; count < MAX_CANDIDATES && second < 0; count++) {
+        candidates[count] = heap_caps_aligned_alloc(align, size, caps);
+        if(!candidates[count]) {
+            break;
+        }
+        const int block = SRAM_Block(candidates[count]);
+        for(uint32_t i = 0; i < count; i++) {
+            if((SRAM_Block(candidates[i]) == block) == same) {
+                first = i;
+                second = count;
+                break;
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < count; i++) {
+        if((int)i != first && (int)i != second) {
+            free(candidates[i]);
+        }
+    }
+    if(second < 0) {
+        return false;
+    }
+    *source = candidates[first];
+    *dest = candidates[second];
+    return true;
+}
+
+/// @brief Allocates the buffers for \p placement
+/// @return \c false, with nothing allocated, if the heap has no such buffers
+static bool Allocate_Placement(const Placement& placement, uint32_t size, uint32_t align, void** dest, void** source) {
+    *dest = nullptr;
+    *source = nullptr;
+    if(placement.blocks != Blocks::Any) {
+        return Allocate_Blocks(placement.blocks == Blocks::Same, size, align, placement.destCaps, dest, source);
+    }
+    *source = Buffer_Acquire(align, size, placement.sourceCaps);
+    *dest = Buffer_Acquire(align, size, placement.destCaps);
+    if(!*dest || !*source) {
+        Buffer_Release(*source);
+        Buffer_Release(*dest);
+        return false;
+    }
+    return true;
+}
+
+
+/// @brief Runs the CPU kernels and async_memcpy on every internal memory placement
+/// @param size The size of the memory to copy. RTC fast memory only has room for a few kb.
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+void MemoryCopy_Placement(uint32_t size, uint32_t align, const RunnerConfig& config)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nInternal memory placement, %" PRIu32 " bytes\n", size);
+
+    const CopyMethod* methods[placementMethodCount];
+    for (size_t m = 0; m < placementMethodCount; m++) {
+        methods[m] = Find_Method(placementMethods[m]);
+    }
+
+    // Median bandwidth of each method per placement, 0 if it didn't run
+    float results[placementCount][placementMethodCount] = {};
+
+    // Only the DMA capable SRAM placements match the IRAM pool; the rest use the heap.
+    Buffers_Start(size, 2, 0);
+
+    for (size_t p = 0; p < placementCount; p++) {
+        const Placement& placement = placements[p];
+
+        void* source;
+        void* dest;
+        if(!Allocate_Placement(placement, size, align, &dest, &source)) {
+            ESP_LOGW(TAG, "%s: no such buffers of %" PRIu32 " bytes available, skipped\n", placement.desc, size);
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: source %p (%s), dest %p (%s)", placement.desc,
+                 source, Region_Name(source).c_str(), dest, Region_Name(dest).c_str());
+        Initialize_Buffer(source, size);
+
+        for (size_t m = 0; m < placementMethodCount; m++) {
+            CycleStats stats;
+            if (!methods[m] || !Run_Method(*methods[m], dest, source, size, useCache, config, stats))
+                continue;
+            Display_Stats(methods[m]->name, placement.desc, stats, size);
+            results[p][m] = Calc_MBps(stats.median, size);
+            // Give the log output some time to finish before the next method is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+    printf("placement");
+    for (size_t m = 0; m < placementMethodCount; m++) {
+        printf(",%s", placementMethods[m]);
+    }
+    printf("\n");
+    for (size_t p = 0; p < placementCount; p++) {
+        printf("%s", placements[p].desc);
+        for (size_t m = 0; m < placementMethodCount; m++) {
+            printf(",%.2f", results[p][m]);
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    // Bank conflicts would show as same-block copies being slower than different-block ones
+    size_t same = placementCount, different = placementCount;
+    for (size_t p = 0; p < placementCount; p++) {
+        if (placements[p].blocks == Blocks::Same)
+            same = p;
+        else if (placements[p].blocks == Blocks::Different)
+            different = p;
+    }
+    if (same < placementCount && different < placementCount) {
+        for (size_t m = 0; m < placementMethodCount; m++) {
+            if (results[same][m] > 0 && results[different][m] > 0) {
+                ESP_LOGI(TAG, "%s: same block %+.2f%% against different blocks", placementMethods[m],
+                         100.0f * (results[same][m] - results[different][m]) / results[different][m]);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,180 @@
+/*
+* Pool test: heap_caps_aligned_alloc/free against fastcopy::BufferPool on IRAM
+* and PSRAM.
+*
+* + latency: min/mean/max cycles to get and give back one buffer, 64 bytes up
+* + churn: the same random sequence of mixed-size allocations and frees on both,
+*   reporting the heap's free space against its largest free block afterwards,
+*   and what the pool lost to rounding up to its size classes
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/pool.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Pool";
+
+/// @brief Allocations timed per size
+static const uint32_t POOL_RUNS = 50;
+
+/// @brief Allocations and frees in the churn test, and the most buffers it holds at once
+static const uint32_t CHURN_STEPS = 1000;
+static const uint32_t CHURN_LIVE = 8;
+
+struct PoolRegion {
+    const char* desc;
+    uint32_t caps;
+    /// @brief Size classes from one cache line up, and buffers per class
+    uint32_t classes;
+    uint32_t buffers;
+};
+
+static const PoolRegion poolRegions[] = {
+    { "IRAM",  MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, 9,  2 },
+    { "PSRAM", MALLOC_CAP_SPIRAM,                    11, 4 },
+};
+
+
+/// @brief Min/mean/max of a set of timings
+struct Latency {
+    uint32_t min, max;
+    uint64_t total;
+    uint32_t count;
+
+    void add(uint32_t cycles) {
+        if(count == 0 || cycles < min) min = cycles;
+        if(cycles > max) max = cycles;
+        total += cycles;
+        count++;
+    }
+};
+
+static void Display_Latency(const char* what, const char* desc, size_t size, const Latency& l) {
+    ESP_LOGI(TAG, "%s %s %u bytes: min %" PRIu32 " mean %" PRIu32 " max %" PRIu32 " cycles",
+             what, desc, (unsigned)size, l.min, l.count ? (uint32_t)(l.total / l.count) : 0, l.max);
+}
+
+
+/// @brief A fixed pseudo-random sequence, so the heap and the pool see the same churn
+static uint32_t Churn_Next(uint32_t& state) {
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+/// @brief Allocates and frees random sizes up to \p maxSize, keeping at most CHURN_LIVE buffers.
+/// Uses the pool if given, the heap otherwise. Frees everything at the end.
+static uint32_t Churn(BufferPool* pool, uint32_t caps, size_t maxSize, void (*report)(BufferPool*, uint32_t)) {
+    void* live[CHURN_LIVE] = {};
+    uint32_t state = 12345;
+    uint32_t failed = 0;
+    const uint32_t ls = internal::getCacheLineSize();
+
+    for(uint32_t step = 0; step < CHURN_STEPS; step++) {
+        void*& slot = live[Churn_Next(state) % CHURN_LIVE];
+        const size_t size = ls + Churn_Next(state) % (maxSize - ls);
+        if(slot) {
+            if(pool) pool->release(slot); else free(slot);
+            slot = nullptr;
+        } else {
+            slot = pool ? pool->acquire(size) : heap_caps_aligned_alloc(ls, size, caps);
+            failed += slot == nullptr;
+        }
+    }
+
+    report(pool, caps);
+
+    for(void* buffer : live) {
+        if(pool) pool->release(buffer); else free(buffer);
+    }
+    return failed;
+}
+
+static void Report_Heap(BufferPool*, uint32_t caps) {
+    const size_t freeSize = heap_caps_get_free_size(caps);
+    const size_t largest = heap_caps_get_largest_free_block(caps);
+    ESP_LOGI(TAG, "  heap: %u bytes free, largest block %u (%.1f%% fragmented)",
+             (unsigned)freeSize, (unsigned)largest, freeSize ? 100.0f * (freeSize - largest) / freeSize : 0.0f);
+}
+
+static void Report_Pool(BufferPool* pool, uint32_t) {
+    Display_Pool_Stats("  churn", pool->stats());
+}
+
+
+/// @brief Compares the heap and a BufferPool for allocation latency and fragmentation
+void Buffer_Pool_Compare()
+{
+
+    ESP_LOGI(TAG, "\n\nBuffer pool against the heap\n");
+
+    const uint32_t ls = internal::getCacheLineSize();
+
+    for (const PoolRegion& region : poolRegions) {
+        BufferPool pool;
+        const BufferPoolConfig config = { .caps = region.caps, .minSize = ls, .classes = region.classes, .buffers = region.buffers };
+        if (pool.start(config) != ESP_OK) {
+            continue;
+        }
+        const size_t maxSize = pool.maxSize();
+
+        for (size_t size = ls; size <= maxSize; size *= 4) {
+            Latency heapAlloc = {}, heapFree = {};
+            for (uint32_t run = 0; run < POOL_RUNS; run++) {
+                const uint32_t tstart = esp_cpu_get_cycle_count();
+                void* buffer = heap_caps_aligned_alloc(ls, size, region.caps);
+                const uint32_t tallocated = esp_cpu_get_cycle_count();
+                free(buffer);
+                const uint32_t tstop = esp_cpu_get_cycle_count();
+                heapAlloc.add(tallocated - tstart);
+                heapFree.add(tstop - tallocated);
+            }
+
+            Latency poolAcquire = {}, poolRelease = {};
+            for (uint32_t run = 0; run < POOL_RUNS; run++) {
+                const uint32_t tstart = esp_cpu_get_cycle_count();
+                void* buffer = pool.acquire(size);
+                const uint32_t tacquired = esp_cpu_get_cycle_count();
+                pool.release(buffer);
+                const uint32_t tstop = esp_cpu_get_cycle_count();
+                poolAcquire.add(tacquired - tstart);
+                poolRelease.add(tstop - tacquired);
+            }
+
+            Display_Latency("heap_caps_aligned_alloc", region.desc, size, heapAlloc);
+            Display_Latency("free", region.desc, size, heapFree);
+            Display_Latency("BufferPool::acquire", region.desc, size, poolAcquire);
+            Display_Latency("BufferPool::release", region.desc, size, poolRelease);
+            printf("\n");
+        }
+
+        ESP_LOGI(TAG, "%s churn, %" PRIu32 " steps, up to %" PRIu32 " buffers of %u to %u bytes:",
+                 region.desc, CHURN_STEPS, CHURN_LIVE, (unsigned)ls, (unsigned)maxSize);
+        Report_Heap(nullptr, region.caps);
+        const uint32_t heapFailed = Churn(nullptr, region.caps, maxSize, &Report_Heap);
+        pool.resetStats();
+        Churn(&pool, region.caps, maxSize, &Report_Pool);
+        ESP_LOGI(TAG, "  heap: %" PRIu32 " allocations failed", heapFailed);
+        printf("\n");
+
+        pool.stop();
+
+        // Give the log output some time to finish before the next region.
+        vTaskDelay(50/portTICK_PERIOD_MS);
+    }
+
+}
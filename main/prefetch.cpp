@@ -0,0 +1,101 @@
+/*
+* Prefetch test: copies from PSRAM with copy_prefetch() at a range of preload
+* distances, next to memcpy and the PIE kernel without a preload.
+*
+* Every run starts with the source out of the cache, as in the other tests, so
+* the preload is the only thing that can bring lines in early.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/kernels.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Prefetch";
+
+/// @brief Preload distances tried, in bytes
+static const uint32_t distances[] = { 256, 512, 1024, 2048, 4096, 8192 };
+
+/// @brief The distance used by kernel_prefetch_at()
+static uint32_t distance;
+
+static IRAM_ATTR void kernel_prefetch_at(void* dest, const void* source, size_t size) {
+    copy_prefetch(dest, source, size, distance);
+}
+
+
+/// @brief Copies from PSRAM with and without a cache preload ahead of the copy
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Prefetch(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nprefetch test, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+        if (!(pair.sourceCaps & MALLOC_CAP_SPIRAM))
+            continue;
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        uint32_t baseline = 0;
+        for (const char* name : { "memcpy", "PIE 128-bit unaligned" }) {
+            const CopyMethod* method = Find_Method(name);
+            clearBuffer(dest, size);
+            const uint32_t cycles = Time_Copy(*method, dest, source, size, useCache);
+            Display_Results(method->name, pair.desc, 0, cycles, dest, source, size);
+            if (baseline == 0 || cycles < baseline)
+                baseline = cycles;
+        }
+
+        for (uint32_t d : distances) {
+            distance = d;
+            const CopyMethod method = { "PIE 128-bit prefetch ", &kernel_prefetch_at, 1, true, false };
+
+            char desc[48];
+            snprintf(desc, sizeof(desc), "%s %" PRIu32 " bytes ahead", pair.desc, d);
+
+            clearBuffer(dest, size);
+            const uint32_t cycles = Time_Copy(method, dest, source, size, useCache);
+            ESP_LOGI(TAG, "%s%s: %+.1f%% against the faster of memcpy and PIE", method.name, desc,
+                     100.0f * ((float)baseline / cycles - 1.0f));
+            Display_Results(method.name, desc, 0, cycles, dest, source, size);
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
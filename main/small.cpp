@@ -0,0 +1,153 @@
+/*
+* Small copy test: cycles per call for copies of 16 to 256 bytes, where the
+* setup of a general-purpose copy costs as much as moving the data.
+*
+* + memcpy with the size known at compile time (the compiler may expand it)
+* + memcpy with the size only known at run time
+* + dsps_memcpy_aes3
+* + fastcopy::copy<N>() with 16-byte (PIE) and 4-byte (32-bit) alignment
+*
+* Every method is called through a function pointer, and the cycles of calling
+* an empty function the same way are subtracted.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "dsps_mem.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/fixed.hpp"
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+static const char *TAG = "Small Copy";
+
+/// @brief Number of calls timed for each method and size, the fastest is reported
+static const uint32_t SMALL_RUNS = 64;
+
+typedef void (*SmallCopy)(void* dest, const void* source);
+
+/// @brief Keeps the compiler from treating the size as a constant
+static volatile size_t runtimeSize;
+
+static void IRAM_ATTR __attribute__((noinline)) Copy_Empty(void* dest, const void* source)
+{
+    __asm__ __volatile__("" ::: "memory");
+}
+
+template<size_t N>
+static void IRAM_ATTR __attribute__((noinline)) Copy_Memcpy(void* dest, const void* source)
+{
+    memcpy(dest, source, N);
+}
+
+static void IRAM_ATTR __attribute__((noinline)) Copy_Memcpy_Runtime(void* dest, const void* source)
+{
+    memcpy(dest, source, runtimeSize);
+}
+
+template<size_t N>
+static void IRAM_ATTR __attribute__((noinline)) Copy_DSP(void* dest, const void* source)
+{
+    dsps_memcpy_aes3(dest, const_cast<void*>(source), N);
+}
+
+template<size_t N, size_t Align>
+static void IRAM_ATTR __attribute__((noinline)) Copy_Fixed(void* dest, const void* source)
+{
+    fastcopy::copy<N, Align>(dest, source);
+}
+
+
+/// @brief Times single calls of \p copy and returns the fastest, after one untimed call
+static uint32_t Time_Small(SmallCopy copy, void* dest, const void* source)
+{
+    uint32_t best = UINT32_MAX;
+    copy(dest, source);
+    for(uint32_t run = 0; run < SMALL_RUNS; run++) {
+        const uint32_t tstart = esp_cpu_get_cycle_count();
+        copy(dest, source);
+        const uint32_t tstop = esp_cpu_get_cycle_count();
+        if(tstop - tstart < best) {
+            best = tstop - tstart;
+        }
+    }
+    return best;
+}
+
+/// @brief Times and checks one method, returning its cycles less \p overhead, or 0 if the copy was wrong
+static uint32_t Run_Small(SmallCopy copy, void* dest, const void* source, size_t size, uint32_t overhead, const char* name)
+{
+    clearBuffer(dest, size);
+    const uint32_t cycles = Time_Small(copy, dest, source);
+    if(!fastcopy::equal(source, dest, size)) {
+        ESP_LOGE(TAG, "%s %u bytes failed because the buffers don't match!", name, (unsigned)size);
+        return 0;
+    }
+    return cycles > overhead ? cycles - overhead : 0;
+}
+
+/// @brief Runs every method for \p N bytes and prints one row
+template<size_t N>
+static void Run_Size(void* dest, const void* source, uint32_t overhead)
+{
+    runtimeSize = N;
+    const uint32_t memcpyConst = Run_Small(&Copy_Memcpy<N>, dest, source, N, overhead, "memcpy");
+    const uint32_t memcpyRuntime = Run_Small(&Copy_Memcpy_Runtime, dest, source, N, overhead, "memcpy runtime size");
+    const uint32_t dsp = Run_Small(&Copy_DSP<N>, dest, source, N, overhead, "DSP AES3");
+    const uint32_t pie = Run_Small(&Copy_Fixed<N, 16>, dest, source, N, overhead, "copy<N, 16>");
+    const uint32_t word = Run_Small(&Copy_Fixed<N, 4>, dest, source, N, overhead, "copy<N, 4>");
+
+    printf("%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+           (unsigned)N, memcpyConst, memcpyRuntime, dsp, pie, word);
+}
+
+template<size_t... N>
+static void Run_Sizes(void* dest, const void* source, uint32_t overhead)
+{
+    (Run_Size<N>(dest, source, overhead), ...);
+}
+
+
+/// @brief Compares memcpy, dsps_memcpy_aes3 and fastcopy::copy<N>() on IRAM->IRAM copies of 16 to 256 bytes
+/// @param align The alignment size to use when allocating the memory, at least 16
+void MemoryCopy_Small(uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nSmall copies, cycles per call\n");
+
+    const uint32_t size = 256;
+    void* source = heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL);
+    void* dest = heap_caps_aligned_alloc(align, size, MALLOC_CAP_INTERNAL);
+    if(!dest || !source) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        free(source);
+        free(dest);
+        return;
+    }
+    Initialize_Buffer(source, size);
+
+    const uint32_t overhead = Time_Small(&Copy_Empty, dest, source);
+    ESP_LOGI(TAG, "call overhead: %" PRIu32 " cycles (subtracted)", overhead);
+
+    printf("bytes,memcpy,memcpy runtime size,DSP AES3,copy<N 16>,copy<N 4>\n");
+    Run_Sizes<16, 32, 48, 64, 96, 128, 192, 256>(dest, source, overhead);
+    printf("\n");
+
+    free(source);
+    free(dest);
+
+    // Give the log output some time to finish.
+    vTaskDelay(50/portTICK_PERIOD_MS);
+
+}
@@ -0,0 +1,190 @@
+/*
+* Statistical runner: warmup, repeated runs and a robust summary per
+* (method, region pair, size), so small differences between methods can be
+* told apart from noise caused by interrupts, FreeRTOS ticks and cache state.
+*
+*/
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+using namespace std;
+
+static const char *TAG = "Stats";
+
+
+CycleStats Compute_Stats(uint32_t* samples, size_t count, float outlierLimit)
+{
+    CycleStats stats = {};
+    if (count == 0)
+        return stats;
+
+    sort(samples, samples + count);
+    stats.samples = count;
+    stats.min = samples[0];
+    stats.max = samples[count - 1];
+    stats.median = samples[count / 2];
+    stats.p99 = samples[(count * 99 + 99) / 100 - 1]; // nearest rank
+
+    // Median absolute deviation. Floored at 0.1% of the median, otherwise a
+    // near-deterministic IRAM copy would have every off-by-one sample rejected.
+    vector<uint32_t> deviations(count);
+    for (size_t i = 0; i < count; i++)
+        deviations[i] = samples[i] > stats.median ? samples[i] - stats.median : stats.median - samples[i];
+    nth_element(deviations.begin(), deviations.begin() + count / 2, deviations.end());
+    const float mad = max((float)deviations[count / 2], stats.median / 1000.0f);
+    const float limit = outlierLimit * 1.4826f * mad; // 1.4826 scales the MAD to a standard deviation
+
+    double sum = 0;
+    double sumSquares = 0;
+    uint32_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (fabsf((float)samples[i] - (float)stats.median) > limit)
+            continue;
+        sum += samples[i];
+        sumSquares += (double)samples[i] * samples[i];
+        kept++;
+    }
+    stats.rejected = count - kept;
+    stats.mean = sum / kept;
+    stats.stddev = kept > 1 ? sqrt(max(0.0, (sumSquares - sum * sum / kept) / (kept - 1))) : 0.0f;
+    stats.ci95 = 1.96f * stats.stddev / sqrtf((float)kept);
+
+    return stats;
+}
+
+
+bool Run_Method(const CopyMethod& method, void* dest, void* source, size_t size, bool useCache,
+                const RunnerConfig& config, CycleStats& stats)
+{
+    if (!Method_Supports(method, dest, source, size))
+        return false;
+
+    for (uint32_t run = 0; run < config.warmup; run++) {
+        clearBuffer(dest, size);
+        Time_Copy(method, dest, source, size, useCache);
+    }
+
+    vector<uint32_t> samples(config.repetitions);
+    for (uint32_t run = 0; run < config.repetitions; run++) {
+        clearBuffer(dest, size);
+        samples[run] = Time_Copy(method, dest, source, size, useCache);
+    }
+
+    if (!fastcopy::equal(source, dest, size)) {
+        ESP_LOGE(TAG, "%s%" PRIu32 " bytes failed because the buffers don't match!", method.name, (uint32_t)size);
+        return false;
+    }
+
+    stats = Compute_Stats(samples.data(), samples.size(), config.outlierLimit);
+    return true;
+}
+
+
+void Display_Stats(string prefix, string desc, const CycleStats& stats, uint32_t size)
+{
+    ESP_LOGI(TAG, "%s%s min %" PRIu32 " median %" PRIu32 " p99 %" PRIu32 " max %" PRIu32
+                  " cycles, mean %.1f +-%.2f%%, stddev %.1f, %" PRIu32 "/%" PRIu32 " rejected = %.2f MB/s",
+                  prefix.c_str(),
+                  desc.c_str(),
+                  stats.min, stats.median, stats.p99, stats.max,
+                  stats.mean, stats.mean > 0 ? 100.0f * stats.ci95 / stats.mean : 0.0f,
+                  stats.stddev,
+                  stats.rejected, stats.samples,
+                  Calc_MBps(stats.median, size));
+}
+
+
+bool Is_Significant(const CycleStats& a, const CycleStats& b)
+{
+    const uint32_t na = a.samples - a.rejected;
+    const uint32_t nb = b.samples - b.rejected;
+    if (na < 2 || nb < 2)
+        return false;
+    const float se = sqrtf(a.stddev * a.stddev / na + b.stddev * b.stddev / nb);
+    if (se == 0.0f)
+        return a.mean != b.mean;
+    return fabsf(a.mean - b.mean) / se > 1.96f;
+}
+
+
+/// @brief Runs every method on every region pair through the statistical runner.
+/// For each region pair the methods are then compared against the fastest one.
+/// @param size The size of the memory to copy
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+void MemoryCopy_Stats(uint32_t size, uint32_t align, const RunnerConfig& config)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nstatistical run, %" PRIu32 "kb, %" PRIu32 " warmup, %" PRIu32 " repetitions, outliers > %.1f MAD\n",
+             size/1024, config.warmup, config.repetitions, config.outlierLimit);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        vector<CycleStats> results(copyMethodCount);
+        vector<bool> valid(copyMethodCount, false);
+        size_t fastest = SIZE_MAX;
+        for (size_t m = 0; m < copyMethodCount; m++) {
+            valid[m] = Run_Method(copyMethods[m], dest, source, size, useCache, config, results[m]);
+            if (!valid[m])
+                continue;
+            Display_Stats(copyMethods[m].name, pair.desc, results[m], size);
+            if (fastest == SIZE_MAX || results[m].mean < results[fastest].mean)
+                fastest = m;
+            // Give the log output some time to finish before the next method is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+
+        if (fastest != SIZE_MAX) {
+            ESP_LOGI(TAG, "%s compared to %s:", pair.desc, Method_Label(copyMethods[fastest]).c_str());
+            for (size_t m = 0; m < copyMethodCount; m++) {
+                if (!valid[m] || m == fastest)
+                    continue;
+                ESP_LOGI(TAG, "  %s+%.2f%% %s", copyMethods[m].name,
+                         100.0f * (results[m].mean - results[fastest].mean) / results[fastest].mean,
+                         Is_Significant(results[m], results[fastest]) ? "(significant)" : "(within noise)");
+            }
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
@@ -0,0 +1,179 @@
+/*
+* Streaming test: processes a PSRAM buffer tile by tile in internal RAM, once
+* serially (memcpy a tile, then process it) and once through the double-buffered
+* fastcopy::StreamPipeline, where the DMA fetches the next tile during processing.
+*
+* The processing is a checksum over the tile, repeated to stand in for light and
+* heavy work. The summed checksums of both runs must match.
+*
+* That says nothing when there are no passes, so for each tile size both runs
+* are also made once untimed with a CRC-32 over the tiles as they arrive, which
+* must match the CRC-32 of the source.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/compare.hpp"
+#include "fastcopy/stream.hpp"
+#include "fastcopy/pool.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Stream";
+
+/// @brief Tile sizes tried
+static const uint32_t tileSizes[] = { 4 * 1024, 16 * 1024 };
+
+/// @brief Checksum passes per tile: transfer only, light and heavy processing
+static const uint32_t workloads[] = { 0, 1, 4 };
+
+/// @brief State passed to the tile callback
+struct Work {
+    uint32_t passes;
+    uint64_t sum;
+    /// @brief Also chain a CRC-32 over the tiles, which must arrive in order
+    bool verify;
+    uint32_t crc;
+    /// @brief Offset the next tile should have, and whether one didn't
+    size_t next;
+    bool outOfOrder;
+};
+
+
+static void Process_Tile(void* tile, size_t size, size_t offset, void* arg)
+{
+    Work& work = *(Work*)arg;
+    for (uint32_t pass = 0; pass < work.passes; pass++) {
+        work.sum += checksum(tile, size);
+    }
+    if (work.verify) {
+        work.outOfOrder |= offset != work.next;
+        work.next = offset + size;
+        work.crc = crc32(tile, size, work.crc);
+    }
+}
+
+
+/// @brief The same work without any overlap: each tile is copied by the CPU and then processed
+static uint32_t Run_Serial(void* tile, uint32_t tileSize, const void* source, uint32_t size, Work& work)
+{
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+    for (uint32_t offset = 0; offset < size; offset += tileSize) {
+        const uint32_t len = (size - offset) < tileSize ? (size - offset) : tileSize;
+        memcpy(tile, (const uint8_t*)source + offset, len);
+        Process_Tile(tile, len, offset, &work);
+    }
+    return esp_cpu_get_cycle_count() - tstart;
+}
+
+
+/// @brief Runs the source through \p tile and through \p pipeline once each, untimed, and checks
+/// that the tiles together have the CRC-32 of the source, \p expected
+static bool Verify_Tiles(StreamPipeline& pipeline, void* tile, uint32_t tileSize, void* source, uint32_t size, uint32_t expected)
+{
+    Work serial = { .passes = 0, .sum = 0, .verify = true };
+    Run_Serial(tile, tileSize, source, size, serial);
+
+    Work piped = { .passes = 0, .sum = 0, .verify = true };
+    uncacheForRead(source, size);
+    if (pipeline.run(source, size, &Process_Tile, &piped) != ESP_OK)
+        return false;
+
+    for (const Work* work : { &serial, &piped }) {
+        if (work->outOfOrder || work->next != size || work->crc != expected)
+            return false;
+    }
+    return true;
+}
+
+
+/// @brief Streams a PSRAM buffer through internal RAM tiles serially and double-buffered
+/// @param size The size of the PSRAM buffer
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Stream(uint32_t size, uint32_t align)
+{
+
+    ESP_LOGI(TAG, "\n\nstreaming test, %" PRIu32 "kb from PSRAM\n", size/1024);
+
+    void* source = heap_caps_aligned_alloc(align, size, MALLOC_CAP_SPIRAM);
+    if(!source) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        return;
+    }
+    Initialize_Buffer(source, size);
+    const uint32_t sourceCrc = crc32(source, size);
+
+    // All tiles, the serial one and the pipeline's two, come from one pool with a class per tile size
+    BufferPool tilePool;
+    const BufferPoolConfig poolConfig = { .caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, .minSize = tileSizes[0], .classes = 3, .buffers = 3 };
+    if(tilePool.start(poolConfig) != ESP_OK) {
+        free(source);
+        return;
+    }
+
+    for (uint32_t tileSize : tileSizes) {
+        StreamPipeline pipeline;
+        void* tile = tilePool.acquire(tileSize);
+        if (!tile || pipeline.start(tileSize, &tilePool) != ESP_OK) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            tilePool.release(tile);
+            continue;
+        }
+
+        if (!Verify_Tiles(pipeline, tile, tileSize, source, size, sourceCrc))
+            ESP_LOGE(TAG, "%" PRIu32 "kb tiles failed because they don't match the source!", tileSize/1024);
+
+        for (uint32_t passes : workloads) {
+            char desc[48];
+            snprintf(desc, sizeof(desc), "%" PRIu32 "kb tiles, %" PRIu32 " passes", tileSize/1024, passes);
+
+            // Both runs start with nothing of the source in the cache
+            Work serial = { passes, 0 };
+            uncacheForRead(source, size);
+            const uint32_t serialCycles = Run_Serial(tile, tileSize, source, size, serial);
+
+            Work piped = { passes, 0 };
+            uncacheForRead(source, size);
+            if (pipeline.run(source, size, &Process_Tile, &piped) != ESP_OK) {
+                ESP_LOGE(TAG, "%s failed to stream", desc);
+                continue;
+            }
+            const StreamStats& stats = pipeline.stats();
+
+            if (serial.sum != piped.sum) {
+                ESP_LOGE(TAG, "%s failed because the checksums don't match!", desc);
+                continue;
+            }
+
+            const uint64_t hidden = stats.transferCycles > stats.waitCycles ? stats.transferCycles - stats.waitCycles : 0;
+            ESP_LOGI(TAG, "%s: serial %.2f MB/s, pipelined %.2f MB/s (%.2fx), transfer %" PRIu32 " / process %" PRIu32 " / wait %" PRIu32 " cycles, %.1f%% of the transfer hidden",
+                     desc, Calc_MBps(serialCycles, size), Calc_MBps((uint32_t)stats.totalCycles, size),
+                     (float)serialCycles / stats.totalCycles,
+                     (uint32_t)stats.transferCycles, (uint32_t)stats.processCycles, (uint32_t)stats.waitCycles,
+                     stats.transferCycles ? 100.0f * hidden / stats.transferCycles : 0.0f);
+
+            // Give the log output some time to finish before the next test is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+        printf("\n");
+
+        tilePool.release(tile);
+    }
+
+    Display_Pool_Stats("tile", tilePool.stats());
+    free(source);
+
+}
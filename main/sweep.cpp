@@ -0,0 +1,221 @@
+/*
+* Size sweep: runs every copy method across each region pair for power-of-two sizes
+* and reports the bandwidth curves and the sizes at which the best method changes.
+*
+* The crossover sizes are what the fast_memcpy dispatch thresholds
+* (CONFIG_FASTCOPY_PIE_MIN_SIZE, CONFIG_FASTCOPY_DMA_MIN_SIZE) should be set to.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/compare.hpp"
+
+#include "benchmark.h"
+
+using namespace std;
+
+static const char *TAG = "Sweep";
+
+/// @brief Number of times each copy is run. The fastest run is reported.
+static const uint32_t SWEEP_RUNS = 5;
+
+
+/// @brief Formats a size in bytes as B, KB or MB
+static string Size_Label(uint32_t size) {
+    char buffer[16];
+    if (size >= 1024 * 1024)
+        snprintf(buffer, sizeof(buffer), "%" PRIu32 " MB", size / (1024 * 1024));
+    else if (size >= 1024)
+        snprintf(buffer, sizeof(buffer), "%" PRIu32 " KB", size / 1024);
+    else
+        snprintf(buffer, sizeof(buffer), "%" PRIu32 " B", size);
+    return string(buffer);
+}
+
+
+/// @brief Allocates the largest power-of-two sized source and destination buffers for a region pair
+/// @param pair the regions to allocate in
+/// @param minSize smallest acceptable size
+/// @param maxSize largest size wanted
+/// @param align the alignment size to use when allocating the memory
+/// @param dest receives the destination buffer
+/// @param source receives the source buffer
+/// @return the size of the buffers, or 0 if not even \p minSize could be allocated
+static uint32_t Allocate_Pair(const RegionPair& pair, uint32_t minSize, uint32_t maxSize, uint32_t align, void** dest, void** source)
+{
+    for (uint32_t size = maxSize; size >= minSize; size /= 2) {
+        *source = Buffer_Acquire(align, size, pair.sourceCaps);
+        *dest = Buffer_Acquire(align, size, pair.destCaps);
+        if (*source && *dest) {
+            return size;
+        }
+        Buffer_Release(*source);
+        Buffer_Release(*dest);
+    }
+    *source = nullptr;
+    *dest = nullptr;
+    return 0;
+}
+
+
+/// @brief Runs one method for one size, returning the fastest of SWEEP_RUNS runs
+/// @return bandwidth in MB/s, or 0 if the method can't do this size or the copy failed
+static float Sweep_Method(const CopyMethod& method, void* dest, void* source, uint32_t size, bool useCache)
+{
+    if (!Method_Supports(method, dest, source, size))
+        return 0.0f;
+
+    uint32_t best = UINT32_MAX;
+    for (uint32_t run = 0; run < SWEEP_RUNS; run++) {
+        clearBuffer(dest, size);
+        const uint32_t cycles = Time_Copy(method, dest, source, size, useCache);
+        if (cycles < best)
+            best = cycles;
+    }
+
+    if (!fastcopy::equal(source, dest, size)) {
+        ESP_LOGE(TAG, "%s%" PRIu32 " bytes failed because the buffers don't match!", method.name, size);
+        return 0.0f;
+    }
+    return Calc_MBps(best, size);
+}
+
+
+/// @brief Finds the smallest size from which method \p a is faster than method \p b for every larger size
+/// @return the size, or 0 if \p a doesn't win at the largest size
+static uint32_t Find_Threshold(const vector<uint32_t>& sizes, const vector<float>& results,
+                               const CopyMethod* a, const CopyMethod* b)
+{
+    if (!a || !b)
+        return 0;
+    const size_t ia = a - copyMethods;
+    const size_t ib = b - copyMethods;
+    uint32_t threshold = 0;
+    for (size_t s = sizes.size(); s-- > 0; ) {
+        const float* row = &results[s * copyMethodCount];
+        if (row[ia] <= row[ib])
+            break;
+        threshold = sizes[s];
+    }
+    return threshold;
+}
+
+
+/// @brief Prints the bandwidth table for one region pair and the sizes where the best method changes
+static void Report_Pair(const RegionPair& pair, const vector<uint32_t>& sizes, const vector<float>& results)
+{
+    // Bandwidth curves as CSV, so they can be pasted into the results sheet
+    printf("\nsize");
+    for (size_t m = 0; m < copyMethodCount; m++)
+        printf(",%s", Method_Label(copyMethods[m]).c_str());
+    printf("\n");
+    for (size_t s = 0; s < sizes.size(); s++) {
+        printf("%" PRIu32, sizes[s]);
+        for (size_t m = 0; m < copyMethodCount; m++)
+            printf(",%.2f", results[s * copyMethodCount + m]);
+        printf("\n");
+    }
+    printf("\n");
+
+    // Crossovers
+    ESP_LOGI(TAG, "%s best method by size:", pair.desc);
+    size_t previous = SIZE_MAX;
+    for (size_t s = 0; s < sizes.size(); s++) {
+        const float* row = &results[s * copyMethodCount];
+        size_t best = SIZE_MAX;
+        for (size_t m = 0; m < copyMethodCount; m++) {
+            if (copyMethods[m].dispatch)
+                continue;
+            if (best == SIZE_MAX || row[m] > row[best])
+                best = m;
+        }
+        if (best != previous) {
+            ESP_LOGI(TAG, "  from %s: %s(%.2f MB/s)", Size_Label(sizes[s]).c_str(), copyMethods[best].name, row[best]);
+            previous = best;
+        }
+    }
+}
+
+
+/// @brief Runs every copy method on every region pair for power-of-two sizes and reports the crossovers
+/// @param minSize The smallest size to copy, a power of two
+/// @param maxSize The largest size to copy, a power of two. Reduced per region pair to what can be allocated.
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Sweep(uint32_t minSize, uint32_t maxSize, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nsize sweep, %s to %s, fastest of %" PRIu32 " runs\n",
+             Size_Label(minSize).c_str(), Size_Label(maxSize).c_str(), SWEEP_RUNS);
+
+    uint32_t pieThreshold = 0;
+    uint32_t dmaThreshold = 0;
+
+    // Where maxSize doesn't fit the pools, Allocate_Pair() halves it on the heap.
+    Buffers_Start(maxSize);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* dest;
+        void* source;
+        const uint32_t size = Allocate_Pair(pair, minSize, maxSize, align, &dest, &source);
+        if (size == 0) {
+            ESP_LOGE(TAG, "Memory Allocation failed for %s", pair.desc);
+            continue;
+        }
+        ESP_LOGI(TAG, "%s: sweeping up to %s", pair.desc, Size_Label(size).c_str());
+        Initialize_Buffer(source, size);
+
+        vector<uint32_t> sizes;
+        for (uint32_t s = minSize; s <= size; s *= 2)
+            sizes.push_back(s);
+
+        vector<float> results(sizes.size() * copyMethodCount, 0.0f);
+        for (size_t s = 0; s < sizes.size(); s++) {
+            for (size_t m = 0; m < copyMethodCount; m++) {
+                results[s * copyMethodCount + m] = Sweep_Method(copyMethods[m], dest, source, sizes[s], useCache);
+                // Let the idle task run so the task watchdog stays quiet.
+                vTaskDelay(1);
+            }
+        }
+
+        Report_Pair(pair, sizes, results);
+
+        if (strcmp(pair.desc, "IRAM->IRAM") == 0) {
+            pieThreshold = Find_Threshold(sizes, results, Find_Method("PIE 128-bit (32 byte loop)"), Find_Method("memcpy"));
+        }
+        if (strcmp(pair.desc, "PSRAM->PSRAM") == 0) {
+            dmaThreshold = Find_Threshold(sizes, results, Find_Method("async_memcpy"), Find_Method("memcpy"));
+        }
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+
+        // Give the log output some time to finish before the next region pair.
+        vTaskDelay(50/portTICK_PERIOD_MS);
+    }
+
+    Buffers_Stop();
+
+    ESP_LOGI(TAG, "Suggested fastcopy thresholds (0 = never faster):");
+    ESP_LOGI(TAG, "  CONFIG_FASTCOPY_PIE_MIN_SIZE=%" PRIu32, pieThreshold);
+    ESP_LOGI(TAG, "  CONFIG_FASTCOPY_DMA_MIN_SIZE=%" PRIu32, dmaThreshold);
+
+}
@@ -0,0 +1,200 @@
+/*
+* Transform test: the fused copy-and-transform kernels against a memcpy
+* followed by the same transform as a second pass in place, on every region
+* pair.
+*
+* + 16-bit byte swap, e.g. RGB565 for an SPI display
+* + 32-bit byte swap
+* + constant AND/XOR mask, here clearing the top byte and inverting the rest
+* + RGB888->RGB565, byte swapped
+*
+* Bandwidth is given in source bytes. Every result is checked against a
+* plain byte-by-byte reference.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/cache.hpp"
+#include "fastcopy/compare.hpp"
+#include "fastcopy/transform.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Transform";
+
+static const uint32_t AND_MASK = 0x00ffffff;
+static const uint32_t XOR_MASK = 0x00ffffff;
+
+/// @brief A transform under test, \p size being the number of source bytes. Must work in place.
+typedef void (*TransformKernel)(void* dest, const void* source, size_t size);
+
+struct TransformMethod {
+    const char* name;
+    TransformKernel kernel;
+    /// @brief The same transform, one byte at a time
+    TransformKernel reference;
+    /// @brief Bytes written per 6 source bytes
+    uint32_t outPer6;
+};
+
+
+static IRAM_ATTR void kernel_mask(void* dest, const void* source, size_t size) {
+    copy_mask(dest, source, size, AND_MASK, XOR_MASK);
+}
+
+static IRAM_ATTR void kernel_rgb565(void* dest, const void* source, size_t size) {
+    convert_rgb888_rgb565(dest, source, size / 3, true);
+}
+
+static void reference_swap16(void* dest, const void* source, size_t size) {
+    const uint8_t* s = (const uint8_t*)source;
+    uint8_t* d = (uint8_t*)dest;
+    for (size_t i = 0; i + 2 <= size; i += 2) {
+        d[i] = s[i + 1];
+        d[i + 1] = s[i];
+    }
+}
+
+static void reference_swap32(void* dest, const void* source, size_t size) {
+    const uint8_t* s = (const uint8_t*)source;
+    uint8_t* d = (uint8_t*)dest;
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        for (size_t b = 0; b < 4; b++)
+            d[i + b] = s[i + 3 - b];
+    }
+}
+
+static void reference_mask(void* dest, const void* source, size_t size) {
+    const uint8_t* s = (const uint8_t*)source;
+    uint8_t* d = (uint8_t*)dest;
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        for (size_t b = 0; b < 4; b++)
+            d[i + b] = (s[i + b] & (uint8_t)(AND_MASK >> (8 * b))) ^ (uint8_t)(XOR_MASK >> (8 * b));
+    }
+}
+
+static void reference_rgb565(void* dest, const void* source, size_t size) {
+    const uint8_t* s = (const uint8_t*)source;
+    uint8_t* d = (uint8_t*)dest;
+    for (size_t i = 0, o = 0; i + 3 <= size; i += 3, o += 2) {
+        d[o] = (s[i] & 0xf8) | (s[i + 1] >> 5);
+        d[o + 1] = ((s[i + 1] & 0x1c) << 3) | (s[i + 2] >> 3);
+    }
+}
+
+static const TransformMethod transformMethods[] = {
+    { "swap16 ",          &copy_swap16,   &reference_swap16, 6 },
+    { "swap32 ",          &copy_swap32,   &reference_swap32, 6 },
+    { "AND/XOR mask ",    &kernel_mask,   &reference_mask,   6 },
+    { "RGB888->RGB565 ",  &kernel_rgb565, &reference_rgb565, 4 },
+};
+
+
+/// @brief Times one transform, fused or as memcpy and a second pass, with the same cache preparation and flushing as Time_Copy
+static IRAM_ATTR uint32_t Time_Transform(const TransformMethod& method, bool fused, void* dest, void* source,
+                                         size_t size, bool useCache)
+{
+    const bool needFlush = prepareCache(dest, source, size, useCache);
+
+    const uint32_t tstart = esp_cpu_get_cycle_count();
+
+    if (fused) {
+        method.kernel(dest, source, size);
+    } else {
+        memcpy(dest, source, size);
+        method.kernel(dest, dest, size);
+    }
+
+    if (needFlush) {
+        // The two-pass version has written all of dest, the fused one only the output.
+        const size_t written = fused ? size / 6 * method.outPer6 : size;
+        compiler_mem_barrier(dest, written);
+        flushCache(dest, written);
+    }
+
+    return esp_cpu_get_cycle_count() - tstart;
+}
+
+
+/// @brief Runs every transform fused and as copy-then-transform on every region pair
+/// @param size The number of source bytes, a multiple of 48 so every transform has whole cache lines
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Transform(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\ncopy and transform, %" PRIu32 "kb\n", size/1024);
+
+    void* expected = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!expected) {
+        ESP_LOGE(TAG, "Memory Allocation failed");
+        return;
+    }
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        for (const TransformMethod& method : transformMethods) {
+            const size_t outSize = size / 6 * method.outPer6;
+            method.reference(expected, source, size);
+
+            uint32_t cycles[2] = {};
+            for (bool fused : { false, true }) {
+                clearBuffer(dest, size);
+                const uint32_t c = Time_Transform(method, fused, dest, source, size, useCache);
+                const std::string prefix = std::string(method.name) + (fused ? "fused " : "copy+pass ");
+                if (fastcopy::equal(dest, expected, outSize)) {
+                    Display_Performance(prefix, pair.desc, 0, c, size);
+                    cycles[fused] = c;
+                } else {
+                    ESP_LOGE(TAG, "%s%s failed because the buffers don't match!", prefix.c_str(), pair.desc);
+                }
+
+                // Give the log output some time to finish before the next test is run.
+                vTaskDelay(50/portTICK_PERIOD_MS);
+            }
+
+            if (cycles[0] && cycles[1])
+                ESP_LOGI(TAG, "%s%s fused takes %.1f%% of the time of copy+pass", method.name, pair.desc, 100.0f * cycles[1] / cycles[0]);
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+    free(expected);
+
+}
@@ -0,0 +1,109 @@
+/*
+* Unaligned copy test: runs the PIE kernels on buffers at various offsets from a
+* 16-byte boundary and with an odd size, next to memcpy and DSP AES3.
+*
+* The first case is fully aligned, so the unaligned PIE kernel can be compared
+* against the aligned 16 and 32 byte loops it is meant to replace.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "benchmark.h"
+
+using namespace std;
+
+static const char *TAG = "Unaligned";
+
+/// @brief A source/destination misalignment to test
+struct Offsets {
+    uint32_t source;
+    uint32_t dest;
+    /// @brief Bytes taken off the copy size, to give an odd length
+    uint32_t shorten;
+};
+
+static const Offsets offsets[] = {
+    { 0,  0,  0  },
+    { 0,  0,  13 },
+    { 1,  0,  13 },
+    { 0,  1,  13 },
+    { 3,  7,  13 },
+    { 8,  8,  13 },
+    { 15, 1,  13 },
+};
+
+static const char* const methodNames[] = {
+    "memcpy",
+    "DSP AES3",
+    "PIE 128-bit (16 byte loop)",
+    "PIE 128-bit (32 byte loop)",
+    "PIE 128-bit unaligned",
+};
+
+
+/// @brief Copies misaligned and odd sized buffers with memcpy, DSP AES3 and the PIE kernels
+/// @param size The size of the buffers. The copies are up to 45 bytes shorter.
+/// @param align The alignment size to use when allocating the memory
+void MemoryCopy_Unaligned(uint32_t size, uint32_t align)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nunaligned copy test, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        for (const Offsets& o : offsets) {
+            uint8_t* s = (uint8_t*)source + o.source;
+            uint8_t* d = (uint8_t*)dest + o.dest;
+            const uint32_t len = size - 32 - o.shorten;
+
+            char desc[64];
+            snprintf(desc, sizeof(desc), "%s src+%" PRIu32 " dest+%" PRIu32 " %" PRIu32 " bytes",
+                     pair.desc, o.source, o.dest, len);
+
+            for (const char* name : methodNames) {
+                const CopyMethod* method = Find_Method(name);
+                if (!method || !Method_Supports(*method, d, s, len))
+                    continue;
+
+                clearBuffer(dest, size);
+                const uint32_t cycles = Time_Copy(*method, d, s, len, useCache);
+                Display_Results(method->name, desc, 0, cycles, d, s, len);
+            }
+            printf("\n");
+        }
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}
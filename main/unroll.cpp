@@ -0,0 +1,99 @@
+/*
+* Unroll test: every member of the copy_pie_unrolled() family, 1 to 8 Q registers
+* in each load/store order, through the statistical runner on every region pair.
+*
+* Reports each variant's median and the best variant per region pair.
+*
+*/
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "fastcopy/unroll.hpp"
+
+#include "benchmark.h"
+
+using namespace fastcopy;
+
+static const char *TAG = "Unroll";
+
+#define UNROLL_METHODS(N) \
+    { "PIE x" #N " grouped ",   &copy_pie_unrolled<N, PieSchedule::Grouped>,   16 * N, true, false }, \
+    { "PIE x" #N " paired ",    &copy_pie_unrolled<N, PieSchedule::Paired>,    16 * N, true, false }, \
+    { "PIE x" #N " staggered ", &copy_pie_unrolled<N, PieSchedule::Staggered>, 16 * N, true, false }
+
+static const CopyMethod unrollMethods[] = {
+    UNROLL_METHODS(1),
+    UNROLL_METHODS(2),
+    UNROLL_METHODS(3),
+    UNROLL_METHODS(4),
+    UNROLL_METHODS(5),
+    UNROLL_METHODS(6),
+    UNROLL_METHODS(7),
+    UNROLL_METHODS(8),
+};
+
+
+/// @brief Runs every PIE unroll variant on every region pair
+/// @param size The size of the memory to copy, a multiple of 16 * 1..8 bytes for every variant to run
+/// @param align The alignment size to use when allocating the memory
+/// @param config Warmup, repetitions and outlier rejection
+void MemoryCopy_Unroll(uint32_t size, uint32_t align, const RunnerConfig& config)
+{
+
+    // Decide whether to use the PSRAM cache
+    bool useCache = false;
+#ifdef USE_CACHE
+    useCache = true;
+#endif
+
+    ESP_LOGI(TAG, "\n\nPIE unroll family, %" PRIu32 "kb\n", size/1024);
+
+    Buffers_Start(size);
+
+    for (size_t p = 0; p < regionPairCount; p++) {
+        const RegionPair& pair = regionPairs[p];
+
+        void* source = Buffer_Acquire(align, size, pair.sourceCaps);
+        void* dest = Buffer_Acquire(align, size, pair.destCaps);
+        if(!dest || !source) {
+            ESP_LOGE(TAG, "Memory Allocation failed");
+            Buffer_Release(source);
+            Buffer_Release(dest);
+            break;
+        }
+        Initialize_Buffer(source, size);
+
+        const CopyMethod* best = nullptr;
+        CycleStats bestStats = {};
+        for (const CopyMethod& method : unrollMethods) {
+            CycleStats stats;
+            if (!Run_Method(method, dest, source, size, useCache, config, stats))
+                continue;
+            Display_Stats(method.name, pair.desc, stats, size);
+            if (!best || stats.median < bestStats.median) {
+                best = &method;
+                bestStats = stats;
+            }
+            // Give the log output some time to finish before the next method is run.
+            vTaskDelay(50/portTICK_PERIOD_MS);
+        }
+
+        if (best) {
+            ESP_LOGI(TAG, "%s best: %s, %.2f MB/s", pair.desc, Method_Label(*best).c_str(), Calc_MBps(bestStats.median, size));
+        }
+        printf("\n");
+
+        Buffer_Release(source);
+        Buffer_Release(dest);
+    }
+
+    Buffers_Stop();
+
+}